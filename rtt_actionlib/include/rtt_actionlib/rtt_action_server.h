@@ -311,7 +311,7 @@ namespace rtt_actionlib {
 
         // Check if the item is due for deletion from the status list
         if((*it).handle_destruction_time_ != ros::Time() &&
-           (*it).handle_destruction_time_ + this->status_list_timeout_ < rtt_rosclock::host_now()){
+           (*it).handle_destruction_time_ + this->status_list_timeout_ < status_array.header.stamp){
           it = this->status_list_.erase(it);
         } else {
           ++it;
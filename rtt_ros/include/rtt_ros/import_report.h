@@ -0,0 +1,96 @@
+#ifndef __RTT_ROS_IMPORT_REPORT_H
+#define __RTT_ROS_IMPORT_REPORT_H
+
+#include <string>
+#include <vector>
+
+#include <rtt/Time.hpp>
+
+namespace rtt_ros {
+
+  /** \brief Timing of one call to rtt_ros::import()
+   *
+   * The time spent in the ComponentLoader (loading libraries, registering
+   * types and transports, and registering components) is measured per
+   * package, along with the number of types and transports it added.
+   */
+  struct ImportReport
+  {
+    //! Timing of one imported package
+    struct Package
+    {
+      Package() :
+        cached(false), find(0.0), parse(0.0), import(0.0),
+        imported(false), types(0), transports(0) { }
+
+      //! The ROS package name
+      std::string name;
+      //! True if the package was found in the package cache
+      bool cached;
+      //! Time spent locating the package and reading its manifest
+      RTT::Seconds find;
+      //! Time spent parsing its manifest (part of find)
+      RTT::Seconds parse;
+      //! Time spent in ComponentLoader::import(), if it was imported
+      RTT::Seconds import;
+      //! True if ComponentLoader::import() succeeded
+      bool imported;
+      //! Number of types added by the import
+      unsigned int types;
+      //! Number of transports added to types by the import
+      unsigned int transports;
+    };
+
+    ImportReport() :
+      crawl(0.0), dependencies(0.0), search_paths(0.0), import(0.0), total(0.0),
+      prefetch_threads(0), prefetch_bytes(0) { }
+
+    //! The package given to rtt_ros::import()
+    std::string package;
+    //! Time spent crawling the ROS_PACKAGE_PATH (part of dependencies)
+    RTT::Seconds crawl;
+    //! Time spent resolving the plugin dependencies
+    RTT::Seconds dependencies;
+    //! Time spent assembling the library search path
+    RTT::Seconds search_paths;
+    //! Time spent importing packages
+    RTT::Seconds import;
+    //! Total time spent in rtt_ros::import()
+    RTT::Seconds total;
+    //! Number of threads reading libraries ahead
+    unsigned int prefetch_threads;
+    //! Number of bytes read ahead
+    unsigned long prefetch_bytes;
+    //! All dependencies, in the order in which they were found
+    std::vector<Package> packages;
+
+    //! Get the package with the given name, adding it if needed
+    Package& getPackage(const std::string &name);
+
+    //! Format the report as a JSON object
+    std::string toJSON() const;
+  };
+
+  /** \brief Enable or disable recording an ImportReport for each import()
+   *
+   * Reports are recorded if this has been enabled, or if the
+   * RTT_ROS_IMPORT_REPORT environment variable names a file to which they are
+   * written after each import.
+   */
+  void setImportProfiling(bool enabled);
+
+  //! Check if an ImportReport is recorded for each import()
+  bool getImportProfiling();
+
+  //! Get the reports of all imports since profiling was enabled
+  std::vector<ImportReport> getImportReports();
+
+  //! Write the reports of all imports as a JSON array to a file
+  bool writeImportReports(const std::string &filename);
+
+  //! Record the report of an import
+  void addImportReport(const ImportReport &report);
+
+}
+
+#endif // __RTT_ROS_IMPORT_REPORT_H
@@ -0,0 +1,71 @@
+#ifndef __RTT_ROS_LIBRARY_PREFETCHER_H
+#define __RTT_ROS_LIBRARY_PREFETCHER_H
+
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace rtt_ros {
+
+  /** \brief Reads plugin libraries into the page cache in background threads
+   *
+   * Loading a plugin library is mostly waiting for the library to be read
+   * from disk, and glibc runs dlopen() and the relocation of libraries under
+   * a process-wide lock, so plugins cannot be loaded in parallel. Instead, the
+   * libraries of all packages to import are read in parallel worker threads,
+   * in import order, while they are loaded one after the other by the
+   * ComponentLoader.
+   */
+  class LibraryPrefetcher
+  {
+  public:
+    //! Create a prefetcher which uses \a threads worker threads
+    LibraryPrefetcher(unsigned int threads);
+
+    //! Waits for the worker threads
+    ~LibraryPrefetcher();
+
+    /** \brief Find the libraries which the ComponentLoader would load for a package
+     *
+     * This looks for shared libraries in the \a package subdirectory of the
+     * directories in \a path_list, like ComponentLoader::import() does.
+     */
+    static void findLibraries(
+        const std::string &package,
+        const std::string &path_list,
+        std::vector<std::string> &libraries);
+
+    //! Start reading \a libraries, in order
+    void start(const std::vector<std::string> &libraries);
+
+    //! Wait until all libraries have been read
+    void join();
+
+    //! Get the number of bytes read by the worker threads
+    unsigned long getBytes() const { return bytes_; }
+
+  private:
+    //! Worker thread loop
+    void run();
+    //! Read one library, and return its size
+    static unsigned long prefetch(const std::string &library);
+
+    //! Number of worker threads
+    unsigned int threads_;
+    //! Worker threads
+    boost::thread_group workers_;
+    //! Guards next_ and bytes_
+    boost::mutex mutex_;
+    //! Libraries to read
+    std::vector<std::string> libraries_;
+    //! Index of the next library to read
+    size_t next_;
+    //! Number of bytes read
+    unsigned long bytes_;
+  };
+
+}
+
+#endif // __RTT_ROS_LIBRARY_PREFETCHER_H
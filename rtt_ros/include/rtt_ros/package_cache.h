@@ -0,0 +1,149 @@
+#ifndef __RTT_ROS_PACKAGE_CACHE_H
+#define __RTT_ROS_PACKAGE_CACHE_H
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <rtt/Time.hpp>
+#include <rtt/os/Mutex.hpp>
+
+namespace rospack {
+  class Rospack;
+}
+
+namespace rtt_ros {
+
+  /** \brief Cache of ROS package locations and RTT plugin dependencies
+   *
+   * Finding a ROS package requires crawling the whole ROS_PACKAGE_PATH, and
+   * its rtt_ros/plugin_depend dependencies are read from its package.xml or
+   * manifest.xml. Both are remembered for the lifetime of the process, and
+   * stored in a cache file in ROS_HOME so that later processes can skip the
+   * crawl.
+   *
+   * The cache file is discarded when ROS_PACKAGE_PATH or the modification
+   * time of one of its directories changes. Cached packages are re-read when
+   * their manifest changed, and the ROS_PACKAGE_PATH is crawled again when a
+   * package is not in the cache or has been moved.
+   *
+   * The cache can be used from several threads. The libxml2 parser is
+   * initialized once, and the manifests of packages which are looked up
+   * together are parsed concurrently.
+   */
+  class PackageCache
+  {
+  public:
+    //! A ROS package and its RTT plugin dependencies
+    struct Package
+    {
+      Package() : is_rosbuild(false), manifest_mtime(0), checked(false) { }
+
+      //! The package directory
+      std::string path;
+      //! The package.xml or manifest.xml file
+      std::string manifest;
+      //! True if this is a rosbuild package (with a manifest.xml)
+      bool is_rosbuild;
+      //! Modification time of the manifest when it was read
+      std::time_t manifest_mtime;
+      //! The rtt_ros/plugin_depend packages of the package
+      std::vector<std::string> plugin_depends;
+      //! True if the manifest has been checked in this process
+      bool checked;
+    };
+
+    //! Time spent finding a package
+    struct Timing
+    {
+      Timing() : cached(false), crawl(0.0), parse(0.0) { }
+
+      //! True if the package was found in the cache
+      bool cached;
+      //! Time spent crawling the ROS_PACKAGE_PATH
+      RTT::Seconds crawl;
+      //! Time spent parsing the manifest
+      RTT::Seconds parse;
+    };
+
+    //! Result of looking up one package
+    struct Lookup
+    {
+      Lookup() : found(false) { }
+      Lookup(const std::string &name) : name(name), found(false) { }
+
+      //! The name of the package to look up
+      std::string name;
+      //! True if the package has been found and its manifest could be read
+      bool found;
+      //! The package, if it has been found
+      Package package;
+      //! Time spent finding the package
+      Timing timing;
+    };
+
+    //! Get the cache of this process
+    static PackageCache& Instance();
+
+    /** \brief Find a ROS package and read its RTT plugin dependencies
+     *
+     * Returns false if the package could not be found or has no manifest.
+     * If \a timing is given, the time spent crawling and parsing is added to
+     * it.
+     */
+    bool find(const std::string &name, Package &package, Timing *timing = NULL);
+
+    /** \brief Find several ROS packages and read their RTT plugin dependencies
+     *
+     * The manifests of packages which are not cached are parsed concurrently.
+     */
+    void find(std::vector<Lookup> &lookups);
+
+    //! Write the cache file if packages have been added since it was read
+    void save();
+
+    //! Forget all packages and remove the cache file
+    void clear();
+
+    //! Get the path of the cache file
+    std::string getCacheFile() const;
+
+  private:
+    struct ManifestReader;
+
+    PackageCache();
+    ~PackageCache();
+
+    //! Read the cache file, unless it is outdated or has already been read
+    void load();
+    //! Crawl the ROS_PACKAGE_PATH, once per process
+    bool crawl(Timing *timing);
+    //! Locate a package and its manifest
+    bool locate(const std::string &name, Package &package, Timing *timing);
+    //! Read the manifests of several packages concurrently
+    static void readManifests(const std::vector<Lookup*> &lookups);
+    //! Read the plugin dependencies from the manifest of a package
+    static bool readManifest(const std::string &name, Package &package, Timing *timing);
+    //! Get the directories of the ROS_PACKAGE_PATH with their modification times
+    static std::vector<std::pair<std::string, std::time_t> > getRoots();
+
+    //! Guards all members; manifests are read without holding it
+    RTT::os::Mutex mutex_;
+    //! The ROS_PACKAGE_PATH for which the packages are cached
+    std::string ros_package_path_;
+    //! The cached packages by name
+    std::map<std::string, Package> packages_;
+    //! The crawled rospack, if it was needed
+    boost::scoped_ptr<rospack::Rospack> rospack_;
+    //! True after the cache file has been read
+    bool loaded_;
+    //! True if packages changed since the cache file has been read
+    bool dirty_;
+  };
+
+}
+
+#endif // __RTT_ROS_PACKAGE_CACHE_H
@@ -3,11 +3,26 @@
 
 #include <string>
 
+#include <rtt_ros/import_report.h>
+
 namespace rtt_ros {
 
   //! Import a ROS package and all of its rtt_ros/plugin_depend dependencies
   bool import(const std::string& package);
 
+  //! Import a ROS package like import(), and report where the time was spent
+  bool profileImport(const std::string& package, ImportReport &report);
+
+  /** \brief Set the number of threads which read plugin libraries ahead of import()
+   *
+   * With zero threads (the default, unless the RTT_ROS_IMPORT_THREADS
+   * environment variable is set), libraries are read as they are loaded.
+   */
+  void setImportThreads(unsigned int threads);
+
+  //! Get the number of threads which read plugin libraries ahead of import()
+  unsigned int getImportThreads();
+
 }
 
 #endif // __RTT_ROS_RTT_ROS_H
@@ -0,0 +1,144 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <rtt/Logger.hpp>
+#include <rtt/os/Mutex.hpp>
+#include <rtt/os/MutexLock.hpp>
+
+#include <rtt_ros/import_report.h>
+
+namespace {
+  //! Get the file to which reports are written after each import, if any
+  std::string getReportFile()
+  {
+    const char *filename = std::getenv("RTT_ROS_IMPORT_REPORT");
+    return (filename != NULL) ? filename : "";
+  }
+
+  //! Record reports, even if no report file has been given
+  bool import_profiling = false;
+
+  //! Reports of all imports, guarded by reports_mutex
+  std::vector<rtt_ros::ImportReport> reports;
+  RTT::os::Mutex reports_mutex;
+
+  //! Quote a string for JSON
+  std::string quote(const std::string &s)
+  {
+    std::ostringstream oss;
+    oss << '"';
+    for(std::string::const_iterator c = s.begin(); c != s.end(); ++c) {
+      switch(*c) {
+        case '"': oss << "\\\""; break;
+        case '\\': oss << "\\\\"; break;
+        case '\n': oss << "\\n"; break;
+        case '\t': oss << "\\t"; break;
+        default:
+          if(static_cast<unsigned char>(*c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(*c));
+            oss << escaped;
+          } else {
+            oss << *c;
+          }
+      }
+    }
+    oss << '"';
+    return oss.str();
+  }
+
+  //! Format a boolean for JSON
+  const char *boolean(bool b) { return b ? "true" : "false"; }
+}
+
+rtt_ros::ImportReport::Package& rtt_ros::ImportReport::getPackage(const std::string &name)
+{
+  for(std::vector<Package>::iterator it = packages.begin(); it != packages.end(); ++it) {
+    if(it->name == name) {
+      return *it;
+    }
+  }
+  packages.push_back(Package());
+  packages.back().name = name;
+  return packages.back();
+}
+
+std::string rtt_ros::ImportReport::toJSON() const
+{
+  std::ostringstream oss;
+  oss << "{\n"
+    << "  \"package\": " << quote(package) << ",\n"
+    << "  \"total\": " << total << ",\n"
+    << "  \"crawl\": " << crawl << ",\n"
+    << "  \"dependencies\": " << dependencies << ",\n"
+    << "  \"search_paths\": " << search_paths << ",\n"
+    << "  \"import\": " << import << ",\n"
+    << "  \"prefetch_threads\": " << prefetch_threads << ",\n"
+    << "  \"prefetch_bytes\": " << prefetch_bytes << ",\n"
+    << "  \"packages\": [";
+
+  for(std::vector<Package>::const_iterator it = packages.begin(); it != packages.end(); ++it) {
+    oss << ((it == packages.begin()) ? "\n" : ",\n")
+      << "    { \"name\": " << quote(it->name)
+      << ", \"cached\": " << boolean(it->cached)
+      << ", \"find\": " << it->find
+      << ", \"parse\": " << it->parse
+      << ", \"import\": " << it->import
+      << ", \"imported\": " << boolean(it->imported)
+      << ", \"types\": " << it->types
+      << ", \"transports\": " << it->transports
+      << " }";
+  }
+
+  oss << "\n  ]\n}";
+  return oss.str();
+}
+
+void rtt_ros::setImportProfiling(bool enabled)
+{
+  import_profiling = enabled;
+}
+
+bool rtt_ros::getImportProfiling()
+{
+  return import_profiling || !getReportFile().empty();
+}
+
+std::vector<rtt_ros::ImportReport> rtt_ros::getImportReports()
+{
+  RTT::os::MutexLock lock(reports_mutex);
+  return reports;
+}
+
+bool rtt_ros::writeImportReports(const std::string &filename)
+{
+  std::vector<ImportReport> all_reports = getImportReports();
+
+  std::ofstream out(filename.c_str());
+  out << "[";
+  for(std::vector<ImportReport>::const_iterator it = all_reports.begin(); it != all_reports.end(); ++it) {
+    out << ((it == all_reports.begin()) ? "\n" : ",\n") << it->toJSON();
+  }
+  out << "\n]\n";
+
+  if(!out) {
+    RTT::log(RTT::Error) << "Could not write import report to \"" << filename << "\"." << RTT::endlog();
+    return false;
+  }
+  return true;
+}
+
+void rtt_ros::addImportReport(const ImportReport &report)
+{
+  {
+    RTT::os::MutexLock lock(reports_mutex);
+    reports.push_back(report);
+  }
+
+  const std::string report_file = getReportFile();
+  if(!report_file.empty()) {
+    writeImportReports(report_file);
+  }
+}
@@ -0,0 +1,129 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+
+#include <rtt/Logger.hpp>
+
+#include <rtt_ros/library_prefetcher.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+  //! Check if a file name looks like a shared library
+  bool isLibrary(const fs::path &path)
+  {
+    const std::string filename = path.filename().string();
+    return boost::algorithm::ends_with(filename, ".so") || boost::algorithm::ends_with(filename, ".dylib");
+  }
+
+  //! Collect the libraries in a directory and its subdirectories (types/, plugins/, ...)
+  void findLibrariesIn(const fs::path &dir, unsigned int depth, std::vector<std::string> &libraries)
+  {
+    boost::system::error_code ec;
+    if(!fs::is_directory(dir, ec)) {
+      return;
+    }
+
+    for(fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+      if(fs::is_directory(it->path(), ec)) {
+        if(depth > 0) {
+          findLibrariesIn(it->path(), depth - 1, libraries);
+        }
+      } else if(isLibrary(it->path())) {
+        libraries.push_back(it->path().string());
+      }
+    }
+  }
+}
+
+rtt_ros::LibraryPrefetcher::LibraryPrefetcher(unsigned int threads) :
+  threads_(threads),
+  next_(0),
+  bytes_(0)
+{
+}
+
+rtt_ros::LibraryPrefetcher::~LibraryPrefetcher()
+{
+  this->join();
+}
+
+void rtt_ros::LibraryPrefetcher::findLibraries(
+    const std::string &package,
+    const std::string &path_list,
+    std::vector<std::string> &libraries)
+{
+  std::vector<std::string> paths;
+  boost::split(paths, path_list, boost::is_any_of(":;"));
+
+  for(std::vector<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it) {
+    if(it->empty()) {
+      continue;
+    }
+    findLibrariesIn(fs::path(*it) / package, 2, libraries);
+    findLibrariesIn(fs::path(*it) / OROCOS_TARGET_NAME / package, 2, libraries);
+  }
+}
+
+void rtt_ros::LibraryPrefetcher::start(const std::vector<std::string> &libraries)
+{
+  this->join();
+
+  libraries_ = libraries;
+  next_ = 0;
+  bytes_ = 0;
+
+  for(unsigned int i=0; i < threads_ && i < libraries_.size(); i++) {
+    workers_.create_thread(boost::bind(&LibraryPrefetcher::run, this));
+  }
+}
+
+void rtt_ros::LibraryPrefetcher::join()
+{
+  workers_.join_all();
+}
+
+void rtt_ros::LibraryPrefetcher::run()
+{
+  while(true) {
+    std::string library;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if(next_ >= libraries_.size()) {
+        return;
+      }
+      library = libraries_[next_++];
+    }
+
+    const unsigned long bytes = prefetch(library);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    bytes_ += bytes;
+  }
+}
+
+unsigned long rtt_ros::LibraryPrefetcher::prefetch(const std::string &library)
+{
+  int fd = ::open(library.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return 0;
+  }
+
+#if defined(POSIX_FADV_WILLNEED)
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+  // Read the whole file, so that it is in the page cache when it is loaded
+  unsigned long bytes = 0;
+  char buffer[64 * 1024];
+  ssize_t n;
+  while((n = ::read(fd, buffer, sizeof(buffer))) > 0) {
+    bytes += n;
+  }
+
+  ::close(fd);
+  return bytes;
+}
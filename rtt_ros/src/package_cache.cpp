@@ -0,0 +1,501 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#include <unistd.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <libxml/parser.h>
+#include <libxml/xpath.h>
+#include <libxml/xpathInternals.h>
+#include <libxml/tree.h>
+
+#include <rtt/Logger.hpp>
+#include <rtt/os/TimeService.hpp>
+
+#include <rospack/rospack.h>
+
+#include <rtt_ros/package_cache.h>
+
+namespace fs = boost::filesystem;
+
+namespace {
+  //! First line of the cache file, changed whenever its format changes
+  const char *CACHE_FILE_HEADER = "rtt_ros package cache 1";
+
+  //! The XPath expression selecting the rtt_ros <plugin_depend>s, compiled once
+  xmlXPathCompExprPtr plugin_depend_xpath = NULL;
+  //! Guards evaluating the shared compiled XPath expression
+  boost::mutex plugin_depend_xpath_mutex;
+  boost::once_flag parser_once = BOOST_ONCE_INIT;
+
+  //! Initialize libxml2 and compile the XPath expression
+  void initParser()
+  {
+    xmlInitParser();
+    plugin_depend_xpath = xmlXPathCompile(BAD_CAST "/package/export/rtt_ros/plugin_depend/text()");
+  }
+
+  //! Get the modification time of a file or directory, or 0 if it does not exist
+  std::time_t getModificationTime(const std::string &path)
+  {
+    boost::system::error_code ec;
+    std::time_t mtime = fs::last_write_time(path, ec);
+    return ec ? 0 : mtime;
+  }
+}
+
+rtt_ros::PackageCache& rtt_ros::PackageCache::Instance()
+{
+  static PackageCache instance;
+  return instance;
+}
+
+rtt_ros::PackageCache::PackageCache() :
+  loaded_(false),
+  dirty_(false)
+{
+}
+
+rtt_ros::PackageCache::~PackageCache()
+{
+}
+
+std::string rtt_ros::PackageCache::getCacheFile() const
+{
+  const char *ros_home = std::getenv("ROS_HOME");
+  if(ros_home != NULL) {
+    return (fs::path(ros_home) / "rtt_ros_package_cache").string();
+  }
+  const char *home = std::getenv("HOME");
+  if(home != NULL) {
+    return (fs::path(home) / ".ros" / "rtt_ros_package_cache").string();
+  }
+  return std::string();
+}
+
+std::vector<std::pair<std::string, std::time_t> > rtt_ros::PackageCache::getRoots()
+{
+  std::vector<std::pair<std::string, std::time_t> > roots;
+  const char *ros_package_path = std::getenv("ROS_PACKAGE_PATH");
+  if(ros_package_path == NULL) {
+    return roots;
+  }
+
+  std::vector<std::string> paths;
+  boost::split(paths, ros_package_path, boost::is_any_of(":"));
+  for(std::vector<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it) {
+    if(!it->empty()) {
+      roots.push_back(std::make_pair(*it, getModificationTime(*it)));
+    }
+  }
+  return roots;
+}
+
+void rtt_ros::PackageCache::load()
+{
+  // Start over if the ROS_PACKAGE_PATH has been changed in this process
+  const char *ros_package_path = std::getenv("ROS_PACKAGE_PATH");
+  if(loaded_ && ros_package_path_ == ((ros_package_path != NULL) ? ros_package_path : "")) {
+    return;
+  }
+
+  loaded_ = true;
+  dirty_ = false;
+  packages_.clear();
+  rospack_.reset();
+  ros_package_path_ = (ros_package_path != NULL) ? ros_package_path : "";
+
+  const std::string cache_file = getCacheFile();
+  std::ifstream in(cache_file.c_str());
+  if(!in) {
+    return;
+  }
+
+  std::string line;
+  if(!std::getline(in, line) || line != CACHE_FILE_HEADER) {
+    RTT::log(RTT::Debug) << "Ignoring package cache \"" << cache_file << "\" with an unknown format." << RTT::endlog();
+    return;
+  }
+
+  // Read the cached packages, discarding all of them if the search path has changed
+  std::vector<std::pair<std::string, std::time_t> > roots = getRoots();
+  std::vector<std::pair<std::string, std::time_t> >::const_iterator root = roots.begin();
+  std::map<std::string, Package> packages;
+
+  while(std::getline(in, line)) {
+    std::vector<std::string> fields;
+    boost::split(fields, line, boost::is_any_of("\t"));
+
+    try {
+      if(fields[0] == "path" && fields.size() == 2) {
+        if(fields[1] != ros_package_path_) {
+          RTT::log(RTT::Debug) << "Ignoring package cache \"" << cache_file << "\" for a different ROS_PACKAGE_PATH." << RTT::endlog();
+          return;
+        }
+      } else if(fields[0] == "root" && fields.size() == 3) {
+        if(root == roots.end() || root->first != fields[2] || root->second != boost::lexical_cast<std::time_t>(fields[1])) {
+          RTT::log(RTT::Debug) << "Ignoring outdated package cache \"" << cache_file << "\"." << RTT::endlog();
+          return;
+        }
+        ++root;
+      } else if(fields[0] == "package" && fields.size() >= 6) {
+        Package &package = packages[fields[1]];
+        package.path = fields[2];
+        package.manifest = fields[3];
+        package.is_rosbuild = (fields[4] == "1");
+        package.manifest_mtime = boost::lexical_cast<std::time_t>(fields[5]);
+        package.plugin_depends.assign(fields.begin() + 6, fields.end());
+      } else {
+        RTT::log(RTT::Debug) << "Ignoring corrupt package cache \"" << cache_file << "\"." << RTT::endlog();
+        return;
+      }
+    } catch(boost::bad_lexical_cast &) {
+      RTT::log(RTT::Debug) << "Ignoring corrupt package cache \"" << cache_file << "\"." << RTT::endlog();
+      return;
+    }
+  }
+
+  if(root != roots.end()) {
+    RTT::log(RTT::Debug) << "Ignoring outdated package cache \"" << cache_file << "\"." << RTT::endlog();
+    return;
+  }
+
+  packages_.swap(packages);
+  RTT::log(RTT::Debug) << "Read " << packages_.size() << " ROS packages from package cache \"" << cache_file << "\"." << RTT::endlog();
+}
+
+void rtt_ros::PackageCache::save()
+{
+  RTT::os::MutexLock lock(mutex_);
+
+  if(!dirty_) {
+    return;
+  }
+
+  const std::string cache_file = getCacheFile();
+  if(cache_file.empty()) {
+    return;
+  }
+
+  // Write to a temporary file and rename it, so that other processes never read a partial cache
+  boost::system::error_code ec;
+  fs::create_directories(fs::path(cache_file).parent_path(), ec);
+  std::ostringstream tmp_file;
+  tmp_file << cache_file << "." << ::getpid();
+
+  {
+    std::ofstream out(tmp_file.str().c_str());
+    if(!out) {
+      RTT::log(RTT::Debug) << "Could not write package cache \"" << cache_file << "\"." << RTT::endlog();
+      return;
+    }
+
+    out << CACHE_FILE_HEADER << "\n";
+    out << "path\t" << ros_package_path_ << "\n";
+
+    std::vector<std::pair<std::string, std::time_t> > roots = getRoots();
+    for(std::vector<std::pair<std::string, std::time_t> >::const_iterator it = roots.begin(); it != roots.end(); ++it) {
+      out << "root\t" << it->second << "\t" << it->first << "\n";
+    }
+
+    for(std::map<std::string, Package>::const_iterator it = packages_.begin(); it != packages_.end(); ++it) {
+      const Package &package = it->second;
+      out << "package\t" << it->first << "\t" << package.path << "\t" << package.manifest << "\t"
+        << (package.is_rosbuild ? 1 : 0) << "\t" << package.manifest_mtime;
+      for(std::vector<std::string>::const_iterator dep = package.plugin_depends.begin(); dep != package.plugin_depends.end(); ++dep) {
+        out << "\t" << *dep;
+      }
+      out << "\n";
+    }
+
+    if(!out) {
+      RTT::log(RTT::Debug) << "Could not write package cache \"" << cache_file << "\"." << RTT::endlog();
+      fs::remove(tmp_file.str(), ec);
+      return;
+    }
+  }
+
+  fs::rename(tmp_file.str(), cache_file, ec);
+  if(ec) {
+    RTT::log(RTT::Debug) << "Could not write package cache \"" << cache_file << "\": " << ec.message() << RTT::endlog();
+    fs::remove(tmp_file.str(), ec);
+    return;
+  }
+
+  dirty_ = false;
+}
+
+void rtt_ros::PackageCache::clear()
+{
+  RTT::os::MutexLock lock(mutex_);
+
+  packages_.clear();
+  rospack_.reset();
+  dirty_ = false;
+
+  boost::system::error_code ec;
+  fs::remove(getCacheFile(), ec);
+}
+
+bool rtt_ros::PackageCache::find(const std::string &name, Package &package, Timing *timing)
+{
+  std::vector<Lookup> lookups(1, Lookup(name));
+  this->find(lookups);
+
+  if(timing) {
+    timing->cached = lookups[0].timing.cached;
+    timing->crawl += lookups[0].timing.crawl;
+    timing->parse += lookups[0].timing.parse;
+  }
+  if(lookups[0].found) {
+    package = lookups[0].package;
+  }
+  return lookups[0].found;
+}
+
+void rtt_ros::PackageCache::find(std::vector<Lookup> &lookups)
+{
+  // Packages whose manifests need to be read, and lookups of the same packages
+  std::vector<Lookup*> to_read;
+  std::vector<Lookup*> duplicates;
+
+  {
+    RTT::os::MutexLock lock(mutex_);
+
+    this->load();
+
+    std::set<std::string> pending;
+    for(std::vector<Lookup>::iterator lookup = lookups.begin(); lookup != lookups.end(); ++lookup) {
+      if(pending.count(lookup->name)) {
+        duplicates.push_back(&*lookup);
+        continue;
+      }
+
+      // Use the cached package if its manifest has not changed since it was read
+      std::map<std::string, Package>::iterator it = packages_.find(lookup->name);
+      if(it != packages_.end()) {
+        const std::time_t mtime = it->second.checked ? it->second.manifest_mtime : getModificationTime(it->second.manifest);
+        if(mtime != 0 && mtime == it->second.manifest_mtime) {
+          it->second.checked = true;
+          lookup->found = true;
+          lookup->package = it->second;
+          lookup->timing.cached = true;
+          continue;
+        } else if(mtime != 0) {
+          // Re-read the changed manifest
+          lookup->package = it->second;
+          to_read.push_back(&*lookup);
+          pending.insert(lookup->name);
+          continue;
+        }
+        packages_.erase(it);
+      }
+
+      // Locate the package
+      if(this->locate(lookup->name, lookup->package, &lookup->timing)) {
+        to_read.push_back(&*lookup);
+        pending.insert(lookup->name);
+      }
+    }
+  }
+
+  readManifests(to_read);
+
+  RTT::os::MutexLock lock(mutex_);
+
+  // Cache the packages whose manifests have been read
+  for(std::vector<Lookup*>::iterator lookup = to_read.begin(); lookup != to_read.end(); ++lookup) {
+    if((*lookup)->found) {
+      (*lookup)->package.checked = true;
+      packages_[(*lookup)->name] = (*lookup)->package;
+      dirty_ = true;
+    }
+  }
+
+  for(std::vector<Lookup*>::iterator lookup = duplicates.begin(); lookup != duplicates.end(); ++lookup) {
+    std::map<std::string, Package>::const_iterator it = packages_.find((*lookup)->name);
+    if(it != packages_.end()) {
+      (*lookup)->found = true;
+      (*lookup)->package = it->second;
+      (*lookup)->timing.cached = true;
+    }
+  }
+}
+
+bool rtt_ros::PackageCache::crawl(Timing *timing)
+{
+  if(rospack_) {
+    return true;
+  }
+
+  // Get the package paths
+  std::vector<std::string> ros_package_paths;
+  rospack_.reset(new rospack::Rospack());
+  rospack_->setQuiet(true);
+  rospack_->getSearchPathFromEnv(ros_package_paths);
+
+  if ( ros_package_paths.size() == 0 ) {
+    RTT::log(RTT::Error) << "No paths in the ROS_PACKAGE_PATH environment variable!" << RTT::endlog();
+    rospack_.reset();
+    return false;
+  }
+
+  RTT::log(RTT::Debug) << "Crawling ROS packages in: ";
+  for(size_t i=0; i<ros_package_paths.size(); i++) { RTT::log(RTT::Debug) << ros_package_paths[i]; }
+  RTT::log(RTT::Debug) << RTT::endlog();
+
+  RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+  rospack_->crawl(ros_package_paths,true);
+  if(timing) { timing->crawl += RTT::os::TimeService::Instance()->secondsSince(start); }
+
+  return true;
+}
+
+bool rtt_ros::PackageCache::locate(const std::string &name, Package &package, Timing *timing)
+{
+  if(!this->crawl(timing)) {
+    return false;
+  }
+
+  if(!rospack_->find(name, package.path)) {
+    RTT::log(RTT::Error) << "Could not find ROS package \""<< name << "\" in ROS_PACKAGE_PATH environment variable." <<RTT::endlog();
+    return false;
+  }
+
+  // Construct the package.xml path
+  fs::path package_xml_path = fs::path(package.path) / "package.xml";
+  package.is_rosbuild = false;
+
+  // Check if package.xml file exists
+  if(!fs::is_regular_file( package_xml_path.string() ) ) {
+
+    // Fall back to manifest.xml for rosbuild packages
+    package_xml_path = fs::path(package.path) / "manifest.xml";
+    package.is_rosbuild = true;
+
+    if(!fs::is_regular_file( package_xml_path.string() ) ) {
+      RTT::log(RTT::Error) << "No package.xml or manifest.xml file for ROS package \""<< name << "\" found at "<<package_xml_path.branch_path() <<RTT::endlog();
+      return false;
+    }
+  }
+
+  package.manifest = package_xml_path.string();
+  return true;
+}
+
+//! Reads the manifests of a list of lookups, shared by several threads
+struct rtt_ros::PackageCache::ManifestReader
+{
+  ManifestReader(const std::vector<Lookup*> &lookups) : lookups(lookups), next(0) { }
+
+  void operator()()
+  {
+    while(true) {
+      Lookup *lookup;
+      {
+        boost::mutex::scoped_lock lock(mutex);
+        if(next >= lookups.size()) {
+          return;
+        }
+        lookup = lookups[next++];
+      }
+      lookup->found = PackageCache::readManifest(lookup->name, lookup->package, &lookup->timing);
+    }
+  }
+
+  //! The lookups whose manifests to read
+  const std::vector<Lookup*> &lookups;
+  //! Index of the next lookup to read
+  size_t next;
+  //! Guards next
+  boost::mutex mutex;
+};
+
+void rtt_ros::PackageCache::readManifests(const std::vector<Lookup*> &lookups)
+{
+  boost::call_once(&initParser, parser_once);
+
+  // Read the manifests in this thread unless there are several
+  const unsigned int threads = std::min<size_t>(lookups.size(), std::max(1u, boost::thread::hardware_concurrency()));
+  if(threads <= 1) {
+    ManifestReader reader(lookups);
+    reader();
+    return;
+  }
+
+  // Parse the manifests concurrently in worker threads
+  ManifestReader reader(lookups);
+  boost::thread_group workers;
+  for(unsigned int i=0; i < threads; i++) {
+    workers.create_thread(boost::ref(reader));
+  }
+  workers.join_all();
+}
+
+bool rtt_ros::PackageCache::readManifest(const std::string &name, Package &package, Timing *timing)
+{
+  RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+
+  package.manifest_mtime = getModificationTime(package.manifest);
+  package.plugin_depends.clear();
+
+  // Load package.xml/manifest.xml
+  xmlDocPtr package_doc = xmlReadFile(package.manifest.c_str(), NULL, XML_PARSE_NONET);
+  if(package_doc == NULL) {
+    RTT::log(RTT::Error) << "Could not parse \"" << package.manifest << "\" of ROS package \"" << name << "\"." << RTT::endlog();
+    return false;
+  }
+
+  xmlXPathContextPtr xpath_ctx = xmlXPathNewContext(package_doc);
+  if(xpath_ctx == NULL) {
+    xmlFreeDoc(package_doc);
+    return false;
+  }
+
+  // Get the text of the rtt_ros <plugin_depend>s
+  xmlXPathObjectPtr xpath_obj;
+  {
+    boost::mutex::scoped_lock lock(plugin_depend_xpath_mutex);
+    xpath_obj = xmlXPathCompiledEval(plugin_depend_xpath, xpath_ctx);
+  }
+
+  // Iterate through the nodes
+  if(xpath_obj == NULL || xmlXPathNodeSetIsEmpty(xpath_obj->nodesetval)) {
+    RTT::log(RTT::Debug) << "ROS package \""<< name << "\" has no RTT plugin dependencies." <<RTT::endlog();
+  } else {
+    RTT::log(RTT::Debug) << "ROS package \""<< name << "\" has "<<xpath_obj->nodesetval->nodeNr<<" RTT plugin dependencies." <<RTT::endlog();
+
+    for(int i=0; i < xpath_obj->nodesetval->nodeNr; i++) {
+      if(xpath_obj->nodesetval->nodeTab[i]) {
+        xmlChar *content = xmlNodeGetContent(xpath_obj->nodesetval->nodeTab[i]);
+        if(content) {
+          const std::string dep_name(reinterpret_cast<const char*>(content));
+          xmlFree(content);
+          RTT::log(RTT::Debug) << "Found dependency \""<< dep_name << "\"" <<RTT::endlog();
+          package.plugin_depends.push_back(dep_name);
+        }
+      }
+    }
+  }
+
+  if(xpath_obj) {
+    xmlXPathFreeObject(xpath_obj);
+  }
+  xmlXPathFreeContext(xpath_ctx);
+  xmlFreeDoc(package_doc);
+
+  if(timing) { timing->parse += RTT::os::TimeService::Instance()->secondsSince(start); }
+
+  return true;
+}
@@ -1,145 +1,161 @@
+#include <algorithm>
 #include <cstdlib>
 #include <list>
-#include <queue>
 #include <sstream>
 #include <set>
 
 #include <boost/filesystem.hpp>
 #include <boost/version.hpp>
 
-#include <libxml/parser.h>
-#include <libxml/xpath.h>
-#include <libxml/xpathInternals.h>
-#include <libxml/tree.h>
-
 #include <rtt/RTT.hpp>
 #include <rtt/internal/GlobalService.hpp>
 
 #include <rtt/deployment/ComponentLoader.hpp>
 #include <rtt/Logger.hpp>
+#include <rtt/os/TimeService.hpp>
+#include <rtt/types/TypeInfoRepository.hpp>
 
 #include <ros/package.h>
-#include <rospack/rospack.h>
 
 #include <rtt_ros/rtt_ros.h>
+#include <rtt_ros/package_cache.h>
+#include <rtt_ros/library_prefetcher.h>
+#include <rtt_ros/import_report.h>
+
+namespace {
+  //! Get the default number of import threads from the environment
+  unsigned int getDefaultImportThreads()
+  {
+    const char *threads = std::getenv("RTT_ROS_IMPORT_THREADS");
+    return (threads != NULL) ? std::strtoul(threads, NULL, 10) : 0;
+  }
 
+  //! Number of threads which read plugin libraries ahead of import()
+  unsigned int import_threads = getDefaultImportThreads();
+
+  //! Count the registered types and the transports registered for them
+  void countTypes(unsigned int &types, unsigned int &transports)
+  {
+    RTT::types::TypeInfoRepository::shared_ptr repository = RTT::types::TypeInfoRepository::Instance();
+    std::vector<std::string> names = repository->getTypes();
+    types = names.size();
+    transports = 0;
+    for(std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+      RTT::types::TypeInfo *type_info = repository->type(*it);
+      if(type_info) {
+        transports += type_info->getTransportNames().size();
+      }
+    }
+  }
+}
+
+//! Import a package and its dependencies, and record the timing in \a report, if given
+static bool importPackage(const std::string& package, rtt_ros::ImportReport *report);
+
+void rtt_ros::setImportThreads(unsigned int threads)
+{
+  import_threads = threads;
+}
+
+unsigned int rtt_ros::getImportThreads()
+{
+  return import_threads;
+}
 
 bool rtt_ros::import(const std::string& package)
+{
+  if(!rtt_ros::getImportProfiling()) {
+    return importPackage(package, NULL);
+  }
+
+  rtt_ros::ImportReport report;
+  const bool success = rtt_ros::profileImport(package, report);
+  rtt_ros::addImportReport(report);
+  return success;
+}
+
+bool rtt_ros::profileImport(const std::string& package, rtt_ros::ImportReport &report)
+{
+  report = rtt_ros::ImportReport();
+  report.package = package;
+  return importPackage(package, &report);
+}
+
+static bool importPackage(const std::string& package, rtt_ros::ImportReport *report)
 {
   RTT::Logger::In in("ROSService::import(\""+package+"\")");
 
   boost::shared_ptr<RTT::ComponentLoader> loader = RTT::ComponentLoader::Instance();
 
+  RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+
   // List of packages which could not be loaded
   std::vector<std::string> missing_packages;
 
   // Get the dependencies for a given ROS package --> deps
   try {
-    // Get the package paths
-    std::vector<std::string> ros_package_paths;
-    rospack::Rospack rpack;
-    rpack.setQuiet(true);
-    rpack.getSearchPathFromEnv(ros_package_paths);
+    namespace fs = boost::filesystem;
 
-    RTT::log(RTT::Debug) << "Loading dependencies for ROS package \""<< package << "\" from: ";
-    for(size_t i=0; i<ros_package_paths.size(); i++) { RTT::log(RTT::Debug) << ros_package_paths[i]; }
-    RTT::log(RTT::Debug) << RTT::endlog();
+    // Package locations and dependencies are cached across calls and processes
+    rtt_ros::PackageCache &package_cache = rtt_ros::PackageCache::Instance();
 
-    rpack.crawl(ros_package_paths,true);
-
-    if ( ros_package_paths.size() == 0 ) {
-      RTT::log(RTT::Error) << "No paths in the ROS_PACKAGE_PATH environment variable! Could not load ROS package \"" << package << "\"" << RTT::endlog();
-      return false;
-    }
+    RTT::log(RTT::Debug) << "Loading dependencies for ROS package \""<< package << "\"" << RTT::endlog();
 
     // Add all rtt_ros/plugin_depend dependencies to package names
     std::vector<std::string> deps_to_import;
     std::vector<std::string> search_paths;
-    rpack.setQuiet(true);
 
-    // Read the package.xml for this package
-    std::queue<std::string> dep_names;
-    dep_names.push(package);
+    // Read the package.xml for this package, and then those of its
+    // dependencies, one breadth-first level at a time
+    std::vector<rtt_ros::PackageCache::Lookup> dep_lookups(1, rtt_ros::PackageCache::Lookup(package));
     deps_to_import.push_back(package);
 
-    const xmlChar * rtt_plugin_depend_xpath = xmlCharStrdup("/package/export/rtt_ros/plugin_depend/text()");
-
-    while(!dep_names.empty()) 
+    while(!dep_lookups.empty()) 
     {
-      namespace fs = boost::filesystem;
-
-      // Get the next dep name, store the dep path
-      std::string dep_name, dep_path;
-      dep_name = dep_names.front();
-      dep_names.pop();
-
-      bool dep_found = rpack.find(dep_name,dep_path);
-
-      if(!dep_found) {
-        RTT::log(RTT::Error) << "Could not find ROS package \""<< dep_name << "\" in ROS_PACKAGE_PATH environment variable." <<RTT::endlog();
-        continue;
-      }
-
-      // Construct the package.xml path
-      fs::path package_xml_path = fs::path(dep_path) / "package.xml";
-      bool is_rosbuild_package = false;
-
-      // Check if package.xml file exists
-      if(!boost::filesystem::is_regular_file( package_xml_path.string() ) ) {
-
-        // Fall back to manifest.xml for rosbuild packages
-        package_xml_path = fs::path(dep_path) / "manifest.xml";
-        is_rosbuild_package = true;
+      // Find the deps and their dependencies, reading the manifests concurrently
+      package_cache.find(dep_lookups);
+
+      std::vector<rtt_ros::PackageCache::Lookup> next_dep_lookups;
+      for(std::vector<rtt_ros::PackageCache::Lookup>::const_iterator dep = dep_lookups.begin();
+          dep != dep_lookups.end();
+          ++dep)
+      {
+        if(report) {
+          rtt_ros::ImportReport::Package &package_report = report->getPackage(dep->name);
+          package_report.cached = dep->timing.cached;
+          package_report.find += dep->timing.crawl + dep->timing.parse;
+          package_report.parse += dep->timing.parse;
+          report->crawl += dep->timing.crawl;
+        }
 
-        if(!boost::filesystem::is_regular_file( package_xml_path.string() ) ) {
-          RTT::log(RTT::Error) << "No package.xml or manifest.xml file for ROS package \""<< dep_name << "\" found at "<<package_xml_path.branch_path() <<RTT::endlog();
+        if(!dep->found) {
           continue;
         }
-      }
-
-      // Add package path to the list of search paths
-      if (is_rosbuild_package) {
-        search_paths.push_back((fs::path(dep_path) / "lib" / "orocos").string());
-      }
-
-      // Read in package.xml/manifest.xml
-      xmlInitParser();
-
-      // libxml structures
-      xmlDocPtr package_doc;
-      xmlXPathContextPtr xpath_ctx;
-      xmlXPathObjectPtr xpath_obj;
 
-      // Load package.xml
-      package_doc = xmlParseFile(package_xml_path.string().c_str());
-      xpath_ctx = xmlXPathNewContext(package_doc);
-
-      // Get the text of the rtt_ros <plugin_depend>s
-      xpath_obj = xmlXPathEvalExpression(rtt_plugin_depend_xpath, xpath_ctx);
+        // Add package path to the list of search paths
+        if (dep->package.is_rosbuild) {
+          search_paths.push_back((fs::path(dep->package.path) / "lib" / "orocos").string());
+        }
 
-      // Iterate through the nodes
-      if(xmlXPathNodeSetIsEmpty(xpath_obj->nodesetval)) {
-        RTT::log(RTT::Debug) << "ROS package \""<< dep_name << "\" has no RTT plugin dependencies." <<RTT::endlog();
-      } else {
-        RTT::log(RTT::Debug) << "ROS package \""<< dep_name << "\" has "<<xpath_obj->nodesetval->nodeNr<<" RTT plugin dependencies." <<RTT::endlog();
-
-        for(int i=0; i < xpath_obj->nodesetval->nodeNr; i++) {
-          if(xpath_obj->nodesetval->nodeTab[i]) {
-            std::ostringstream oss;
-            oss << xmlNodeGetContent(xpath_obj->nodesetval->nodeTab[i]);
-            RTT::log(RTT::Debug) << "Found dependency \""<< oss.str() << "\"" <<RTT::endlog();
-            dep_names.push(oss.str());
-
-            // Add the dep to the list of deps to import
-            deps_to_import.push_back(oss.str());
-          }
+        // Add the deps to the list of deps to import
+        for(std::vector<std::string>::const_iterator it = dep->package.plugin_depends.begin();
+            it != dep->package.plugin_depends.end();
+            ++it)
+        {
+          next_dep_lookups.push_back(rtt_ros::PackageCache::Lookup(*it));
+          deps_to_import.push_back(*it);
         }
       }
 
-      xmlXPathFreeObject(xpath_obj);
-      xmlXPathFreeContext(xpath_ctx);
-      xmlFreeDoc(package_doc);
-      xmlCleanupParser();
+      dep_lookups.swap(next_dep_lookups);
+    }
+
+    // Store newly found packages for later imports
+    package_cache.save();
+
+    RTT::os::TimeService::ticks search_paths_start = RTT::os::TimeService::Instance()->getTicks();
+    if(report) {
+      report->dependencies = RTT::os::TimeService::Instance()->secondsSince(start);
     }
 
     // Build path list by prepending paths from search_paths list to the RTT component path in reverse order without duplicates
@@ -154,35 +170,103 @@ bool rtt_ros::import(const std::string& package)
       search_paths_seen.insert(*it);
     }
 
+    if(report) {
+      report->search_paths = RTT::os::TimeService::Instance()->secondsSince(search_paths_start);
+    }
+
     RTT::log(RTT::Debug) << "Attempting to load RTT plugins from "<<deps_to_import.size()<<" packages..." << RTT::endlog();
 
-    // Import each package dependency and the package itself (in deps_to_import[0])
+    RTT::os::TimeService::ticks import_start = RTT::os::TimeService::Instance()->getTicks();
+
+    // Select the packages which have not been imported yet, in import order
+    std::vector<std::string> packages_to_import;
     for(std::vector<std::string>::reverse_iterator it = deps_to_import.rbegin();
         it != deps_to_import.rend();
         ++it)
     {
       // Check if it's already been imported
-      if(*it == "rtt_ros" || loader->isImported(*it)) {
+      if(*it == "rtt_ros" || loader->isImported(*it)
+         || std::find(packages_to_import.begin(), packages_to_import.end(), *it) != packages_to_import.end())
+      {
         RTT::log(RTT::Debug) << "Package dependency '"<< *it <<"' already imported." << RTT::endlog();
         continue;
       }
+      packages_to_import.push_back(*it);
+    }
+
+    // Read the libraries of all packages in the background while they are imported
+    rtt_ros::LibraryPrefetcher prefetcher(import_threads);
+    if(import_threads > 0) {
+      std::vector<std::string> libraries;
+      for(std::vector<std::string>::const_iterator it = packages_to_import.begin();
+          it != packages_to_import.end();
+          ++it)
+      {
+        rtt_ros::LibraryPrefetcher::findLibraries(*it, path_list, libraries);
+      }
+      RTT::log(RTT::Debug) << "Reading " << libraries.size() << " libraries with " << import_threads << " threads..." << RTT::endlog();
+      prefetcher.start(libraries);
+    }
+
+    // Import each package dependency and the package itself (in deps_to_import[0])
+    for(std::vector<std::string>::const_iterator it = packages_to_import.begin();
+        it != packages_to_import.end();
+        ++it)
+    {
+      unsigned int types_before = 0, transports_before = 0;
+      if(report) {
+        countTypes(types_before, transports_before);
+      }
+
+      RTT::os::TimeService::ticks package_start = RTT::os::TimeService::Instance()->getTicks();
 
       // Import the dependency
-      if(loader->import(*it, path_list)) {
-        RTT::log(RTT::Debug) << "Importing Orocos components from ROS package \""<<*it<<"\" SUCCEEDED.";
+      const bool imported = loader->import(*it, path_list);
+      const RTT::Seconds package_duration = RTT::os::TimeService::Instance()->secondsSince(package_start);
+
+      if(report) {
+        rtt_ros::ImportReport::Package &package_report = report->getPackage(*it);
+        package_report.import = package_duration;
+        package_report.imported = imported;
+        countTypes(package_report.types, package_report.transports);
+        package_report.types -= types_before;
+        package_report.transports -= transports_before;
+      }
+
+      if(imported) {
+        RTT::log(RTT::Debug) << "Importing Orocos components from ROS package \""<<*it<<"\" SUCCEEDED";
       } else {
         // Temporarily store the name of the missing package
         missing_packages.push_back(*it);
-        RTT::log(RTT::Debug) << "Importing Orocos components from ROS package \""<<*it<<"\" FAILED.";
+        RTT::log(RTT::Debug) << "Importing Orocos components from ROS package \""<<*it<<"\" FAILED";
       }
-      RTT::log(RTT::Debug) << RTT::endlog();
+      RTT::log(RTT::Debug) << " after " << package_duration << " s." << RTT::endlog();
+    }
+
+    prefetcher.join();
+
+    if(report) {
+      report->import = RTT::os::TimeService::Instance()->secondsSince(import_start);
+      report->prefetch_threads = import_threads;
+      report->prefetch_bytes = prefetcher.getBytes();
     }
 
+    RTT::log(RTT::Info) << "Imported " << packages_to_import.size() << " ROS packages for \"" << package << "\" in "
+      << RTT::os::TimeService::Instance()->secondsSince(start) << " s";
+    if(import_threads > 0) {
+      RTT::log(RTT::Info) << " (" << import_threads << " threads read " << prefetcher.getBytes() / 1024 << " KiB of libraries)";
+    }
+    RTT::log(RTT::Info) << "." << RTT::endlog();
+
   } catch(std::string arg) {
     RTT::log(RTT::Debug) << "While processing the dependencies of " << package << ": Dependency is not a ros package: " << arg << RTT::endlog();
     missing_packages.push_back(arg);
   }
 
+  if(report) {
+    report->total = RTT::os::TimeService::Instance()->secondsSince(start);
+  }
+
   // Report success or failure
   if(missing_packages.size() == 0) { 
     RTT::log(RTT::Info) << "Loaded plugins from ROS package \"" << package << "\" and its dependencies." << RTT::endlog();
@@ -21,6 +21,11 @@
 #include <rospack/rospack.h>
 
 #include <rtt_ros/rtt_ros.h>
+#include <rtt_ros/package_cache.h>
+
+void clearPackageCache() {
+  rtt_ros::PackageCache::Instance().clear();
+}
 
 void loadROSService(){
   RTT::Service::shared_ptr ros = RTT::internal::GlobalService::Instance()->provides("ros");
@@ -31,6 +36,22 @@ void loadROSService(){
   ros->addOperation("import", &rtt_ros::import).doc(
       "Imports the Orocos plugins from a given ROS package (if found) along with the plugins of all of the package's run or exec dependencies as listed in the package.xml.").arg(
           "package", "The ROS package name.");
+
+  ros->addOperation("setImportThreads", &rtt_ros::setImportThreads).doc(
+      "Sets the number of threads which read the plugin libraries of all packages to import in the background, while they are imported one after the other. Zero disables reading ahead.").arg(
+          "threads", "The number of threads.");
+  ros->addOperation("getImportThreads", &rtt_ros::getImportThreads).doc(
+      "Gets the number of threads which read plugin libraries ahead of ros.import().");
+
+  ros->addOperation("setImportProfiling", &rtt_ros::setImportProfiling).doc(
+      "Enables or disables recording how long each ros.import() spends crawling, parsing package.xml files, and loading the plugins of each package.").arg(
+          "enabled", "True to record the timing of all following imports.");
+  ros->addOperation("writeImportReport", &rtt_ros::writeImportReports).doc(
+      "Writes the timing of all imports since profiling has been enabled to a JSON file.").arg(
+          "filename", "The JSON file.");
+
+  ros->addOperation("clearPackageCache", &clearPackageCache).doc(
+      "Forgets the locations and dependencies of all ROS packages found by previous imports, and removes the package cache file.");
 }
 
 using namespace RTT;
@@ -1,18 +1,50 @@
 #ifndef __RTT_ROSCLOCK_PROF_H__
 #define __RTT_ROSCLOCK_PROF_H__
 
-#include <queue>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+
 #include <rtt_rosclock/rtt_rosclock.h>
 
 namespace rtt_rosclock {
+
+  /** \brief Profiles the wall time between tic() and toc()
+   *
+   * The statistics cover the measurements which started at most \a memory
+   * seconds before the last one, or the last \a capacity measurements if
+   * there are more. By default, the capacity holds \a memory seconds of
+   * measurements taken at DEFAULT_RATE. All memory is allocated in the constructor, and each
+   * measurement is added and expired in constant time:
+   *  - the mean and standard deviation are running Welford sums,
+   *  - the minimum and maximum are kept in monotonic queues,
+   *  - percentiles are read from a histogram with logarithmic buckets,
+   *    HISTOGRAM_SUB_BUCKETS per power of two, so they are accurate to
+   *    1/HISTOGRAM_SUB_BUCKETS of their value.
+   */
   class WallProf {
   public:
-    typedef std::pair<ros::Time, ros::Time> TicToc;
-
-    WallProf(double memory) :
-      memory_(memory)
+    enum {
+      //! Rate in Hz of the measurements for which the default capacity holds the whole memory
+      DEFAULT_RATE = 1000,
+      //! Sub-buckets of the histogram per power of two, as a power of two
+      HISTOGRAM_SUB_BITS = 4,
+      HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS,
+      //! Durations up to 2^HISTOGRAM_MAX_BITS ns (about 18 minutes) are resolved
+      HISTOGRAM_MAX_BITS = 40,
+      HISTOGRAM_BUCKETS = (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS
+    };
+
+    //! Profile the last \a memory seconds, or the last \a capacity measurements if it is not 0
+    WallProf(double memory, size_t capacity = 0) :
+      memory_(memory),
+      samples_(std::max<size_t>(capacity > 0 ? capacity : static_cast<size_t>(std::ceil(memory * DEFAULT_RATE)), 1)),
+      min_queue_(samples_.size()),
+      max_queue_(samples_.size()),
+      histogram_(HISTOGRAM_BUCKETS, 0)
     {
-
+      this->clear();
     }
 
     void tic()
@@ -22,62 +54,192 @@ namespace rtt_rosclock {
 
     void toc()
     {
-      ros::Time toc = rtt_rosclock::rtt_wall_now();
-      tictocs_.push_back(std::make_pair(last_tic, toc));
-      while(tictocs_.size() > 1 && (toc - tictocs_.front().first).toSec() > memory_) {
-        tictocs_.pop_front();
+      this->add(last_tic, rtt_rosclock::rtt_wall_now());
+    }
+
+    //! Add a measurement which has been taken otherwise
+    void add(const ros::Time &tic, const ros::Time &toc)
+    {
+      // Expire the measurements which are out of memory
+      while(next_ > first_ && ((toc - samples_[first_ % samples_.size()].tic).toSec() > memory_ || next_ - first_ == samples_.size())) {
+        this->pop();
       }
+
+      Sample &sample = samples_[next_ % samples_.size()];
+      sample.tic = tic;
+      sample.duration = std::max<int64_t>((toc - tic).toNSec(), 0);
+      this->push(next_);
+      next_++;
     }
 
     ros::Duration last()
     {
-      TicToc &last_tictoc = tictocs_.back();
-      return last_tictoc.second - last_tictoc.first;
+      return ros::Duration().fromNSec(samples_[(next_ - 1) % samples_.size()].duration);
     }
 
+    //! Update mean(), min(), max() and stddev(), which takes constant time
     void analyze()
     {
-      if(tictocs_.size() < 1) {
+      const size_t count = this->n();
+      if(count < 1) {
         return;
       }
 
-      TicToc &last_tictoc = tictocs_.back();
-
-      double sum = 0.0;
-      double count = tictocs_.size();
-
-      max_ = 0;
-      min_ = last_tictoc.second.toSec();
+      mean_ = mean_ns_ * 1E-9;
+      min_ = this->duration(min_queue_[min_head_ % min_queue_.size()]) * 1E-9;
+      max_ = this->duration(max_queue_[max_head_ % max_queue_.size()]) * 1E-9;
+      stddev_ = std::sqrt(std::max(m2_, 0.0) / count) * 1E-9;
+    }
 
-      for(std::list<TicToc>::const_iterator it=tictocs_.begin(); it!=tictocs_.end(); ++it) {
-        const double tictoc = (it->second - it->first).toSec();
-        sum += tictoc;
-        max_ = std::max(max_, tictoc);
-        min_ = std::min(min_, tictoc);
+    /** \brief Get the duration below which a fraction \a p of the measurements lie, in seconds
+     *
+     * This scans the histogram, so it takes time proportional to
+     * HISTOGRAM_BUCKETS, but it does not allocate memory.
+     */
+    double percentile(double p) const
+    {
+      const size_t count = this->n();
+      if(count < 1) {
+        return 0.0;
       }
 
-      mean_ = sum/count;
-
-      double err_sum = 0.0;
-
-      for(std::list<TicToc>::const_iterator it=tictocs_.begin(); it!=tictocs_.end(); ++it) {
-        const double tictoc = (it->second - it->first).toSec();
-        err_sum += std::pow(mean_ - tictoc, 2.0);
+      const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * count)));
+      uint64_t seen = 0;
+      for(unsigned int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+        seen += histogram_[bucket];
+        if(seen >= rank) {
+          // The middle of the bucket, within the observed range
+          const int64_t lower = bucketLower(bucket);
+          const int64_t upper = bucketLower(bucket + 1);
+          const int64_t min = this->duration(min_queue_[min_head_ % min_queue_.size()]);
+          const int64_t max = this->duration(max_queue_[max_head_ % max_queue_.size()]);
+          return std::min(std::max((lower + upper) / 2, min), max) * 1E-9;
+        }
       }
 
-      stddev_ = sqrt(err_sum/count);
+      return this->duration(max_queue_[max_head_ % max_queue_.size()]) * 1E-9;
+    }
+
+    //! Forget all measurements
+    void clear()
+    {
+      first_ = next_ = 0;
+      min_head_ = min_tail_ = max_head_ = max_tail_ = 0;
+      mean_ns_ = m2_ = 0.0;
+      std::fill(histogram_.begin(), histogram_.end(), 0);
+      mean_ = min_ = max_ = stddev_ = 0.0;
     }
 
     double mean() { return mean_; }
     double min() { return min_; }
     double max() { return max_; }
     double stddev() { return stddev_; }
-    size_t n() { return tictocs_.size(); }
+    size_t n() const { return next_ - first_; }
 
   private:
+    struct Sample {
+      ros::Time tic;
+      int64_t duration;
+    };
+
+    int64_t duration(uint64_t seq) const { return samples_[seq % samples_.size()].duration; }
+
+    //! Get the histogram bucket of a duration in ns
+    static unsigned int bucket(int64_t ns)
+    {
+      // The first 2 * HISTOGRAM_SUB_BUCKETS buckets are 1ns wide, then the
+      // width doubles every HISTOGRAM_SUB_BUCKETS buckets
+      const uint64_t value = static_cast<uint64_t>(ns);
+      if(value < 2 * HISTOGRAM_SUB_BUCKETS) {
+        return value;
+      }
+      const unsigned int bits = 64 - __builtin_clzll(value);
+      if(bits > HISTOGRAM_MAX_BITS) {
+        return HISTOGRAM_BUCKETS - 1;
+      }
+      const unsigned int shift = bits - HISTOGRAM_SUB_BITS - 1;
+      return shift * HISTOGRAM_SUB_BUCKETS + (value >> shift);
+    }
+
+    //! Get the smallest duration in ns in a histogram bucket
+    static int64_t bucketLower(unsigned int bucket)
+    {
+      if(bucket < 2 * HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+      }
+      const unsigned int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+      return static_cast<int64_t>(bucket % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS) << shift;
+    }
+
+    //! Add the sample \a seq to the statistics
+    void push(uint64_t seq)
+    {
+      const int64_t value = this->duration(seq);
+      const size_t count = next_ - first_ + 1;
+
+      const double delta = value - mean_ns_;
+      mean_ns_ += delta / count;
+      m2_ += delta * (value - mean_ns_);
+
+      histogram_[bucket(value)]++;
+
+      while(min_tail_ > min_head_ && this->duration(min_queue_[(min_tail_ - 1) % min_queue_.size()]) >= value) {
+        min_tail_--;
+      }
+      min_queue_[min_tail_++ % min_queue_.size()] = seq;
+
+      while(max_tail_ > max_head_ && this->duration(max_queue_[(max_tail_ - 1) % max_queue_.size()]) <= value) {
+        max_tail_--;
+      }
+      max_queue_[max_tail_++ % max_queue_.size()] = seq;
+    }
+
+    //! Remove the oldest sample from the statistics
+    void pop()
+    {
+      const int64_t value = this->duration(first_);
+      const size_t count = next_ - first_;
+
+      if(count == 1) {
+        mean_ns_ = m2_ = 0.0;
+      } else {
+        const double mean = (count * mean_ns_ - value) / (count - 1);
+        m2_ -= (value - mean_ns_) * (value - mean);
+        mean_ns_ = mean;
+      }
+
+      histogram_[bucket(value)]--;
+
+      if(min_tail_ > min_head_ && min_queue_[min_head_ % min_queue_.size()] == first_) {
+        min_head_++;
+      }
+      if(max_tail_ > max_head_ && max_queue_[max_head_ % max_queue_.size()] == first_) {
+        max_head_++;
+      }
+
+      first_++;
+    }
+
     ros::Time last_tic;
     double memory_;
-    std::list<TicToc> tictocs_;
+
+    //! Ring buffer of the samples first_ to next_ - 1, indexed by sequence number modulo its size
+    std::vector<Sample> samples_;
+    uint64_t first_;
+    uint64_t next_;
+
+    //! Running mean and sum of squared deviations in ns
+    double mean_ns_;
+    double m2_;
+
+    //! Sequence numbers of samples with increasing and decreasing durations
+    std::vector<uint64_t> min_queue_;
+    std::vector<uint64_t> max_queue_;
+    uint64_t min_head_, min_tail_;
+    uint64_t max_head_, max_tail_;
+
+    //! Number of samples per logarithmic duration bucket
+    std::vector<uint32_t> histogram_;
 
     double mean_;
     double min_;
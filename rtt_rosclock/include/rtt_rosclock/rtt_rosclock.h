@@ -1,6 +1,9 @@
 #ifndef __RTT_ROSCLOCK_RTT_ROSCLOCK_H
 #define __RTT_ROSCLOCK_RTT_ROSCLOCK_H
 
+#include <string>
+#include <vector>
+
 #include <rtt/RTT.hpp>
 #include <rtt/os/TimeService.hpp>
 #include <ros/time.h>
@@ -46,18 +49,136 @@ namespace rtt_rosclock {
    */
   const ros::Time rtt_wall_now();
 
-  //! Get the difference in seconds between rtt_wall_now() and host_wall_now()
+  /** \brief Get the difference in seconds between rtt_wall_now() and host_wall_now()
+   *
+   * The RTT clock is compared with the middle of two reads of the host clock.
+   */
   const RTT::Seconds host_offset_from_rtt();
 
+  /** \brief Start estimating the offset between the RTT and host clocks in the background
+   *
+   * The OffsetEstimator samples the offset every OffsetEstimator::PERIOD
+   * and filters it, which gives a much more stable offset than
+   * host_offset_from_rtt().
+   */
+  const bool enable_host_offset_estimator();
+
+  /** \brief Stop estimating the offset between the RTT and host clocks
+   *
+   * The estimate is dropped, so host_offset_estimate() and host_from_rtt()
+   * fall back to host_offset_from_rtt().
+   */
+  const bool disable_host_offset_estimator();
+
+  /** \brief Get the estimated difference in seconds between host_wall_now() and rtt_wall_now()
+   *
+   * Returns host_offset_from_rtt() if the estimator is not running or has no
+   * estimate yet.
+   */
+  const RTT::Seconds host_offset_estimate();
+
+  /** \brief Convert a time stamp taken with rtt_wall_now() to the host clock
+   *
+   * This does not read any clock and does not block if the offset estimator
+   * is running, so real-time components can take time stamps with the RTT
+   * clock and convert them when they publish them.
+   */
+  const ros::Time host_from_rtt(const ros::Time rtt_time);
+
+  /** \brief Read the host clock from the HighResolutionClock
+   *
+   * When not compiled against Xenomai, host_now() and host_wall_now() then
+   * count with the time stamp counter of the CPU, or CLOCK_MONOTONIC_RAW,
+   * which is cheaper than ros::Time::now() and monotonic, and which is kept
+   * close to CLOCK_REALTIME. ROS simulation time is still read from ROS. The
+   * clock is calibrated on the first call, which takes
+   * HighResolutionClock::CALIBRATION_TIME. Returns false if it is not
+   * available.
+   */
+  const bool use_high_resolution_host_clock();
+
+  //! Read the host clock from ROS or CLOCK_HOST_REALTIME (the default)
+  void use_ros_host_clock();
+
   //! Set a TaskContext to use a periodic simulation clock activity
   const bool set_sim_clock_activity(RTT::TaskContext *t);
 
+  /** \brief Put the simulation clock activity of a TaskContext into an ordering group
+   *
+   * TaskContexts in the same group are executed in sequence, in the order in
+   * which their activities were set, even if the simulation clock activities
+   * are executed in parallel. An empty group name removes the TaskContext from
+   * its group. Returns false if the TaskContext does not have a simulation
+   * clock activity.
+   */
+  const bool set_sim_clock_group(RTT::TaskContext *t, const std::string &group);
+
+  /** \brief Declare that a TaskContext has to be executed before another in simulation
+   *
+   * Both TaskContexts have to have simulation clock activities. Returns false
+   * otherwise.
+   */
+  const bool add_sim_clock_dependency(RTT::TaskContext *before, RTT::TaskContext *after);
+
+  /** \brief Derive the execution order in simulation from data flow connections
+   *
+   * A TaskContext with an output port connected to an input port of another
+   * TaskContext is executed before it, so that data written in a simulation
+   * step is read in the same step. This has to be called again after ports
+   * are connected.
+   */
+  void derive_sim_clock_dependencies();
+
+  /** \brief Set the number of threads which execute the simulation clock activities
+   *
+   * With more than one thread, the activities which are due at a simulation
+   * clock update are executed in parallel, and the update completes once all
+   * of them have been executed.
+   */
+  void set_sim_clock_threads(const unsigned int n);
+
+  //! Get the number of threads which execute the simulation clock activities
+  const unsigned int get_sim_clock_threads();
+
   //! Use ROS /clock topic for time measurement
   void use_ros_clock_topic();
 
   //! Use manual clock updates
   void use_manual_clock();
 
+  //! Use the shared memory clock \a name written by a simulator on the same host
+  const bool use_shared_memory_clock(const std::string &name);
+
+  /** \brief Set the scheduler and priority of the simulation clock thread
+   *
+   * At high simulation rates, the thread receiving the clock should run with
+   * a real-time scheduler (ORO_SCHED_RT) so that it is not delayed by other
+   * threads.
+   */
+  const bool set_sim_clock_thread_scheduler(const int scheduler, const int priority);
+
+  //! Restrict the simulation clock thread to the CPUs in the bit mask \a cpus
+  const bool set_sim_clock_thread_cpu_affinity(const unsigned int cpus);
+
+  //! Get the number of clock ticks received since the simulation clock was enabled
+  const unsigned int get_sim_clock_received_ticks();
+
+  //! Get the number of received clock ticks which have been skipped for a later one
+  const unsigned int get_sim_clock_coalesced_ticks();
+
+  //! Get the number of shared memory clock ticks which have been overwritten before they were read
+  const unsigned int get_sim_clock_dropped_ticks();
+
+  /** \brief Acknowledge each simulation clock update on a ROS topic
+   *
+   * Once all simulation clock activities due at an update have been
+   * executed, the processed time is published on \a topic, so that a
+   * simulator can run in lock-step with the components. An empty topic
+   * disables the acknowledgements. Returns false if the simulation clock is
+   * enabled.
+   */
+  const bool set_sim_clock_lock_step_topic(const std::string &topic);
+
   //! Use a simulated clock source
   const bool enable_sim();
   
@@ -66,6 +187,35 @@ namespace rtt_rosclock {
 
   //! Update the current simulation time and trigger all simulated TaskContexts
   void update_sim_clock(const ros::Time new_time);
+
+  /** \brief Start recording the timings of profiled sections
+   *
+   * The Profiler aggregates the timings of the ProfileSections of all
+   * components and periodically publishes their statistics as a
+   * diagnostic_msgs/DiagnosticArray.
+   */
+  const bool enable_profiler();
+
+  //! Stop recording the timings of profiled sections
+  const bool disable_profiler();
+
+  //! Set the topic of the profile statistics, or an empty string to not publish them
+  const bool set_profiler_topic(const std::string &topic);
+
+  //! Add a profiled section and get its id
+  const unsigned int add_profile_section(const std::string &name);
+
+  //! Get the names of all profiled sections
+  const std::vector<std::string> get_profile_sections();
+
+  //! Get the mean duration of a profiled section in seconds
+  const double get_profile_mean(const std::string &section);
+
+  //! Get the duration in seconds below which a fraction \a p of the executions of a section lie
+  const double get_profile_percentile(const std::string &section, const double p);
+
+  //! Get the number of timings which were lost because a thread buffer was full or the thread was not registered
+  const unsigned int get_profiler_dropped_timings();
 }
 
 #endif // ifndef __RTT_ROSCLOCK_RTT_ROSCLOCK_H
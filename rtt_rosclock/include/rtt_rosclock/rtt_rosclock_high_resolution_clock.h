@@ -0,0 +1,100 @@
+#ifndef __RTT_ROSCLOCK_HIGH_RESOLUTION_CLOCK_H
+#define __RTT_ROSCLOCK_HIGH_RESOLUTION_CLOCK_H
+
+#include <stdint.h>
+
+#include <ros/time.h>
+
+namespace rtt_rosclock {
+
+  /** \brief A cheap and monotonic wall clock for plain Linux hosts
+   *
+   * The clock counts with the invariant time stamp counter of the CPU if
+   * there is one, or else with CLOCK_MONOTONIC_RAW, and converts the counts
+   * with a rate calibrated at startup. About once per second, a caller of
+   * now() compares the clock with CLOCK_REALTIME and adjusts the rate so that
+   * the error is corrected over the next second. The clock never jumps,
+   * unless it is off by more than MAX_SLEW_ERROR, e.g. after the system time
+   * has been set.
+   *
+   * The conversion is published with a sequence lock, so now() never blocks
+   * and takes a few loads and a multiplication.
+   */
+  class HighResolutionClock
+  {
+  public:
+    //! Get the clock, which is shared by all threads
+    static HighResolutionClock &Instance();
+
+    //! Counters on which the clock can be based
+    enum Counter {
+      COUNTER_MONOTONIC_RAW = 0,
+      COUNTER_TSC = 1
+    };
+
+    /** \brief Select the counter and measure its rate
+     *
+     * This takes CALIBRATION_TIME and should be called before the clock is
+     * used in time-critical code. Returns false if no counter is available.
+     */
+    bool calibrate();
+    //! Check if the clock has been calibrated
+    bool isCalibrated() const;
+
+    //! Get the counter on which the clock is based
+    Counter getCounter() const;
+    //! Get the calibrated rate of the counter in counts per second
+    double getFrequency() const;
+
+    //! Get the current wall time
+    const ros::Time now();
+
+    //! Get the difference between CLOCK_REALTIME and this clock in seconds at the last adjustment
+    double getError() const;
+
+    //! Time over which the rate of the counter is measured, in seconds
+    static const double CALIBRATION_TIME;
+    //! Time between two adjustments to CLOCK_REALTIME, in seconds
+    static const double DISCIPLINE_PERIOD;
+    //! Largest relative change of the rate while correcting an error
+    static const double MAX_SLEW_RATE;
+    //! Errors larger than this, in seconds, are corrected by stepping the clock
+    static const double MAX_SLEW_ERROR;
+
+  private:
+    HighResolutionClock();
+    HighResolutionClock(HighResolutionClock const&);
+    void operator=(HighResolutionClock const&);
+
+    //! Read the counter
+    uint64_t count() const;
+    //! Compare the clock at \a count, \a ns with CLOCK_REALTIME and adjust the rate
+    void discipline(uint64_t count, int64_t ns);
+
+    //! Conversion of counts to nanoseconds since the epoch, guarded by sequence_
+    struct Conversion {
+      uint64_t base_count;
+      int64_t base_ns;
+      double ns_per_count;
+    };
+
+    Counter counter_;
+    bool calibrated_;
+    //! Calibrated nanoseconds per count
+    double nominal_ns_per_count_;
+    //! Counts between two adjustments
+    uint64_t discipline_counts_;
+
+    //! Odd while conversion_ is being written
+    volatile uint32_t sequence_;
+    Conversion conversion_;
+    //! The count at which the clock is adjusted next
+    volatile uint64_t next_discipline_;
+    //! Non-zero while a thread adjusts the clock
+    volatile int disciplining_;
+    //! Error at the last adjustment in nanoseconds
+    volatile int64_t error_ns_;
+  };
+}
+
+#endif // ifndef __RTT_ROSCLOCK_HIGH_RESOLUTION_CLOCK_H
@@ -0,0 +1,89 @@
+#ifndef __RTT_ROSCLOCK_OFFSET_ESTIMATOR_H
+#define __RTT_ROSCLOCK_OFFSET_ESTIMATOR_H
+
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <rtt/os/Thread.hpp>
+#include <rtt/os/Time.hpp>
+
+#include <ros/time.h>
+
+namespace rtt_rosclock {
+
+  /** \brief Estimates the offset between the RTT wall clock and the host clock
+   *
+   * This thread periodically compares rtt_wall_now() with host_wall_now().
+   * Each period, it takes several samples and keeps the one for which reading
+   * the clocks took the shortest time, since it is least disturbed by
+   * preemption. The offsets of these samples are filtered by a scalar Kalman
+   * filter, which models the offset as a random walk and weighs each sample
+   * by the time it took.
+   *
+   * The estimate is published with a sequence lock in static members, so
+   * GetOffset() and HostFromRTT() can be called from real-time threads
+   * without getting the singleton.
+   */
+  class OffsetEstimator : public RTT::os::Thread
+  {
+  public:
+    //! Get an instance to the singleton OffsetEstimator or create one
+    static boost::shared_ptr<OffsetEstimator> Instance();
+    //! Get an instance to the singleton OffsetEstimator or NULL
+    static boost::shared_ptr<OffsetEstimator> GetInstance();
+    //! Release the singleton OffsetEstimator
+    static void Release();
+
+    virtual ~OffsetEstimator();
+
+    //! Check if an estimate is available, which is only the case while the estimator runs
+    static bool HasEstimate();
+    //! Get the estimated offset host_wall_now() - rtt_wall_now() in seconds
+    static RTT::Seconds GetOffset();
+    //! Get the standard deviation of the estimated offset in seconds
+    static RTT::Seconds GetUncertainty();
+    //! Convert a time stamp taken with rtt_wall_now() to the host clock
+    static const ros::Time HostFromRTT(const ros::Time &rtt_time);
+
+    //! Time between two updates of the estimate, in seconds
+    static const double PERIOD;
+    //! Number of samples taken in each update
+    static const unsigned int SAMPLES;
+    //! Standard deviation of the change of the offset between two updates, in seconds
+    static const double DRIFT;
+
+  protected:
+    //! Constructor is protected, use Instance() to create and get a singleton
+    OffsetEstimator();
+    OffsetEstimator(OffsetEstimator const&);
+    void operator=(OffsetEstimator const&);
+
+    //! OffsetEstimator singleton
+    static boost::shared_ptr<OffsetEstimator> singleton;
+
+    // RTT::os::Thread interface
+    virtual bool initialize();
+    virtual void step();
+    virtual void finalize();
+
+    //! Read the published offset in nanoseconds
+    static int64_t ReadOffset();
+
+    //! State of the filter, only used by this thread
+    bool initialized_;
+    //! The offset of the first sample in nanoseconds
+    int64_t base_offset_;
+    //! The offset relative to base_offset_ and its variance, in seconds
+    double offset_;
+    double variance_;
+
+    //! Published estimate, guarded by sequence
+    static volatile uint32_t sequence;
+    static volatile int64_t offset_ns;
+    static volatile double uncertainty;
+    static volatile bool has_estimate;
+  };
+}
+
+#endif // ifndef __RTT_ROSCLOCK_OFFSET_ESTIMATOR_H
@@ -0,0 +1,161 @@
+#ifndef __RTT_ROSCLOCK_PROFILER_H
+#define __RTT_ROSCLOCK_PROFILER_H
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <rtt/os/Mutex.hpp>
+#include <rtt/os/Thread.hpp>
+
+#include <ros/ros.h>
+
+#include <rtt_rosclock/prof.h>
+
+namespace rtt_rosclock {
+
+  /** \brief Collects the timings of named code sections of all components
+   *
+   * Components time their sections with ProfileSection. Each thread writes
+   * its timings into its own lock-free ring buffer, so recording does not
+   * block and does not allocate. The buffer is allocated when the thread
+   * starts timing its first section while the profiler runs, or when it is
+   * registered with RegisterThread(). While the profiler runs, this low-priority
+   * thread drains the buffers into a WallProf per section every
+   * DRAIN_PERIOD and publishes their statistics as a
+   * diagnostic_msgs/DiagnosticArray every PERIOD. While it does not run,
+   * timings are not recorded at all.
+   */
+  class Profiler : public RTT::os::Thread
+  {
+  public:
+    //! Get an instance to the singleton Profiler or create one
+    static boost::shared_ptr<Profiler> Instance();
+    //! Get an instance to the singleton Profiler or NULL
+    static boost::shared_ptr<Profiler> GetInstance();
+    //! Release the singleton Profiler
+    static void Release();
+
+    virtual ~Profiler();
+
+    //! Get the id of the section \a name, adding it if it does not exist yet
+    unsigned int addSection(const std::string &name);
+    //! Get the names of all sections
+    std::vector<std::string> getSections();
+
+    //! Set the topic on which the statistics are published, or an empty string to not publish them
+    bool setTopic(const std::string &topic);
+    //! Set the time over which the statistics of a section are computed, in seconds
+    bool setWindow(double window);
+
+    //! Get the mean duration of a section in seconds
+    double getMean(const std::string &section);
+    //! Get the duration in seconds below which a fraction \a p of the executions of a section lie
+    double getPercentile(const std::string &section, double p);
+    //! Get the number of timings which were lost because a thread buffer was full or the thread was not registered
+    unsigned int getDroppedTimings() const;
+
+    //! Allocate the buffer of the calling thread, if it does not have one yet
+    static void RegisterThread();
+    //! Record an execution of a section in the buffer of the calling thread, which has to be registered
+    static void Record(unsigned int section, const ros::Time &tic, const ros::Time &toc);
+    //! Check if timings are recorded
+    static bool Enabled();
+
+    //! Time between two publications, in seconds
+    static const double PERIOD;
+    //! Time between two drains of the thread buffers, in seconds
+    static const double DRAIN_PERIOD;
+    //! Number of timings which fit into the buffer of each thread, per DRAIN_PERIOD
+    static const unsigned int BUFFER_SIZE;
+    //! Largest number of timings in the statistics of a section
+    static const unsigned int CAPACITY;
+
+  protected:
+    //! Constructor is protected, use Instance() to create and get a singleton
+    Profiler();
+    Profiler(Profiler const&);
+    void operator=(Profiler const&);
+
+    //! Profiler singleton
+    static boost::shared_ptr<Profiler> singleton;
+
+    //! True while the profiler runs (see Enabled())
+    static volatile bool enabled;
+
+    // RTT::os::Thread interface
+    virtual bool initialize();
+    virtual void step();
+    virtual void finalize();
+
+    //! Move the timings from the thread buffers into the statistics
+    void drain();
+    //! Get the statistics of a section, or NULL
+    WallProf *find(const std::string &section);
+
+    struct Section {
+      std::string name;
+      boost::shared_ptr<WallProf> prof;
+    };
+
+    //! Mutex guarding the sections and their statistics
+    RTT::os::Mutex sections_mutex_;
+    std::vector<Section> sections_;
+    std::map<std::string, unsigned int> section_ids_;
+    //! Time window of the statistics
+    double window_;
+    //! Number of drains since the profiler was started
+    unsigned int drains_;
+
+    //! Topic of the statistics
+    std::string topic_;
+    //! ROS publisher of the statistics
+    ros::Publisher publisher_;
+  };
+
+  /** \brief A named code section which is timed by the Profiler
+   *
+   * Create the section once, e.g. as a member of a component, and time each
+   * execution with a Scope. The first timing of each thread allocates the
+   * buffer of the thread before the clock is read, so the section can be
+   * executed by any thread, e.g. by the workers of parallel
+   * SimClockActivities:
+   *
+   * \code
+   * void MyComponent::updateHook() {
+   *   rtt_rosclock::ProfileSection::Scope scope(update_section_);
+   *   ...
+   * }
+   * \endcode
+   */
+  class ProfileSection
+  {
+  public:
+    explicit ProfileSection(const std::string &name);
+
+    //! Start timing an execution, for sections which are only executed by one thread
+    void tic();
+    //! Stop timing the execution started with tic()
+    void toc();
+
+    //! Times the section while it is in scope, from any thread
+    class Scope
+    {
+    public:
+      explicit Scope(ProfileSection &section);
+      ~Scope();
+    private:
+      ProfileSection &section_;
+      ros::Time tic_;
+    };
+
+  private:
+    unsigned int id_;
+    ros::Time tic_;
+  };
+}
+
+#endif // ifndef __RTT_ROSCLOCK_PROFILER_H
@@ -70,6 +70,8 @@ namespace rtt_rosclock {
 
     virtual RTT::Seconds getPeriod() const;
     virtual bool setPeriod(RTT::Seconds s);
+    //! True if the activity has no period of its own and is executed at the simulation period
+    bool followsSimulationPeriod() const;
 
     virtual unsigned getCpuAffinity() const;
     virtual bool setCpuAffinity(unsigned cpu);
@@ -94,6 +96,16 @@ namespace rtt_rosclock {
 
     virtual RTT::os::TimeService::ticks getLastExecutionTicks() const;
 
+    /** \brief Put this activity into an ordering group
+     *
+     * When the SimClockActivityManager executes activities in parallel, the
+     * activities of one group are still executed in sequence. An empty group
+     * name removes the activity from its group.
+     */
+    void setGroup(const std::string &group);
+    //! Get the ordering group of this activity, or an empty string
+    std::string getGroup() const;
+
   private:
     std::string name_;
 
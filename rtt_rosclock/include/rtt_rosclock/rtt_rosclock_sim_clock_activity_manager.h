@@ -45,8 +45,16 @@
 
 #include <rtt/os/TimeService.hpp>
 #include <rtt/os/Mutex.hpp>
+#include <rtt/os/Condition.hpp>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace rtt_rosclock {
 
@@ -59,6 +67,28 @@ namespace rtt_rosclock {
    * using a SimClockActivity. This is the primary interface to executing a set of
    * periodic tasks in simulation. 
    *
+   * The activities are executed in an order which respects the dependencies
+   * between them. Dependencies are declared with addDependency(), derived from
+   * the data flow connections between the tasks with deriveDependencies(),
+   * and implied by ordering groups (see setGroup()), whose activities are
+   * executed in the order in which they were created. Otherwise, activities
+   * are executed in the order in which they were created. Dependencies which
+   * would close a cycle are ignored. Changes of the dependencies and groups
+   * take effect in the next update, so they can also be made by the
+   * activities while they are executed.
+   *
+   * By default, the due activities are executed one after the other in the
+   * thread calling update(). With setThreads(), activities whose
+   * dependencies have been executed are executed in parallel by a pool of
+   * worker threads, and update() returns once all of them have been executed.
+   *
+   * The activities are kept in a priority queue keyed by the tick at which
+   * they are next due, so an update only touches the activities which are
+   * due. The periods are cached, and re-read when an activity is started or
+   * its period is changed. Activities without a period of their own follow
+   * the simulation period, so they are due in every update and are kept
+   * apart from the queue. Changing the simulation period therefore does not
+   * change the schedule.
    */
   class SimClockActivityManager 
   {
@@ -74,9 +104,36 @@ namespace rtt_rosclock {
     RTT::Seconds getSimulationPeriod() const;
     void setSimulationPeriod(RTT::Seconds s);
 
+    //! Re-read the periods and last execution times of all activities before the next update
+    void reschedule();
+
     //! Execute all activities modulo their desired periods
     void update();
 
+    /** \brief Set the number of threads which execute activities in update()
+     *
+     * This includes the thread calling update(), so with 0 or 1 threads the
+     * activities are executed sequentially.
+     */
+    void setThreads(unsigned int n);
+    //! Get the number of threads which execute activities in update()
+    unsigned int getThreads() const;
+
+    //! Declare that \a before has to be executed before \a after in each update
+    void addDependency(SimClockActivity *before, SimClockActivity *after);
+    //! Remove all declared dependencies
+    void clearDependencies();
+
+    /** \brief Derive dependencies from data flow connections
+     *
+     * The task of an activity with an output port which is connected to an
+     * input port of the task of another activity is executed before that
+     * task. The connections are followed at the beginning of the next
+     * update, and replace the previously derived dependencies, so this
+     * should be called again after connecting ports.
+     */
+    void deriveDependencies();
+
   protected:
     //! The SimClockActivityManager is a singleton and is constructed by calling Instance()
     SimClockActivityManager();
@@ -93,6 +150,51 @@ namespace rtt_rosclock {
     //! Remove an activity from the manager
     void remove(SimClockActivity *activity);
 
+    //! Put an activity into an ordering group, or into none if \a group is empty
+    void setGroup(SimClockActivity *activity, const std::string &group);
+    //! Get the ordering group of an activity
+    std::string getGroup(SimClockActivity *activity);
+
+    //! An activity in the execution graph
+    struct Node
+    {
+      SimClockActivity *activity;
+      //! Indices of the nodes which depend on this one
+      std::vector<size_t> successors;
+      //! Number of nodes this one depends on
+      size_t n_predecessors;
+      //! Number of nodes this one still waits for in the current update
+      size_t remaining;
+      //! True if the activity is executed in the current update
+      bool due;
+      //! The due nodes which depend on this one in the current update, also via nodes which are not due
+      std::vector<size_t> due_successors;
+      //! Marks the nodes visited while searching for due successors
+      unsigned long visit;
+      //! True if the activity follows the simulation period and is due in every update
+      bool every_update;
+      //! The cached period of the activity
+      RTT::os::TimeService::ticks period;
+      //! The tick at which the activity is due next
+      RTT::os::TimeService::ticks next_due;
+    };
+
+    //! Replace the derived dependencies by the ones of the current data flow connections
+    void followConnections();
+    //! Sort the activities topologically by their dependencies
+    void rebuildGraph();
+    //! Read the periods and last execution times of all activities into the schedule
+    void rebuildSchedule();
+
+    //! Execute the nodes of one update in the worker threads and the calling thread
+    void executeGraph();
+    //! Take ready nodes and execute them until all nodes have been executed
+    void runNodes();
+    //! The loop of a worker thread
+    void workerLoop();
+    //! Join all worker threads
+    void stopWorkers();
+
   private:
 
     //! SimClockActivityManager singleton
@@ -101,11 +203,63 @@ namespace rtt_rosclock {
     //! Mutex used to exclude adding and removing activities from the update to all activities
     RTT::os::Mutex modify_activities_mutex_;
 
+    /** Mutex guarding the changes which may be requested by activities
+     * during an update: the groups, dependencies and dirty flags */
+    RTT::os::Mutex schedule_mutex_;
+
     //! All existing SimClockActivities
     std::list<SimClockActivity *> activities_;
 
     //! The desired/expected simulation period
     RTT::Seconds simulation_period_;
+
+    //! Ordering groups of the activities which have one
+    std::map<SimClockActivity *, std::string> groups_;
+
+    typedef std::set<std::pair<SimClockActivity *, SimClockActivity *> > Dependencies;
+    //! Dependencies declared with addDependency()
+    Dependencies dependencies_;
+    //! Dependencies derived from data flow connections
+    Dependencies derived_dependencies_;
+    //! True if the dependencies are to be derived in the next update
+    bool derive_dependencies_;
+
+    //! True if the activities or their dependencies have changed since the graph was built
+    bool graph_dirty_;
+    //! All activities, sorted topologically
+    std::vector<Node> nodes_;
+
+    typedef std::vector<std::pair<RTT::os::TimeService::ticks, size_t> > Schedule;
+    //! Min-heap of the nodes with their own period by the tick at which they are due next
+    Schedule schedule_;
+    //! The nodes which follow the simulation period, in topological order
+    std::vector<size_t> every_update_;
+    //! True if the periods or last execution times of activities have changed
+    bool schedule_dirty_;
+    //! The nodes which are due in the current update, in topological order
+    std::vector<size_t> due_;
+    //! Nodes left to visit while searching for due successors
+    std::vector<size_t> search_;
+    //! Stamp of the current search for due successors
+    unsigned long visit_stamp_;
+
+    //! Number of threads executing activities, including the one calling update()
+    unsigned int n_threads_;
+    boost::scoped_ptr<boost::thread_group> workers_;
+
+    //! Mutex guarding the execution state of the nodes and the counters below
+    RTT::os::Mutex jobs_mutex_;
+    //! Signalled when nodes become ready, and when an update is done
+    RTT::os::Condition jobs_ready_;
+    //! Nodes whose dependencies have all been executed
+    std::vector<size_t> ready_;
+    //! Number of nodes in the current update
+    size_t n_nodes_;
+    //! Number of nodes which have been executed in the current update
+    size_t done_nodes_;
+    //! Incremented for every update
+    unsigned long generation_;
+    bool stop_workers_;
   };
 
 }
@@ -0,0 +1,81 @@
+#ifndef __RTT_ROSCLOCK_SIM_CLOCK_SHM_H
+#define __RTT_ROSCLOCK_SIM_CLOCK_SHM_H
+
+#include <stdint.h>
+#include <string>
+
+#include <ros/time.h>
+
+namespace rtt_rosclock {
+
+  /** \brief A simulation clock in POSIX shared memory
+   *
+   * A simulator running on the same host writes the simulation time into a
+   * shared memory segment instead of publishing it on /clock, and the
+   * SimClockThread polls it. Each write increments a tick counter, so the
+   * reader can tell how many ticks it has missed. The fields are guarded by a
+   * sequence lock, so neither side ever blocks the other.
+   *
+   * After processing a tick, the reader stores its counter in the
+   * acknowledged field, which a simulator can poll to run in lock-step with
+   * the components.
+   *
+   * The segment starts with a magic number and the size of its layout, so
+   * segments which are too small or have another layout are rejected.
+   */
+  class SimClockShm
+  {
+  public:
+    SimClockShm();
+    ~SimClockShm();
+
+    //! Create the shared memory segment \a name, as the simulator does
+    bool create(const std::string &name);
+    //! Open the existing shared memory segment \a name, as the SimClockThread does
+    bool open(const std::string &name);
+    //! Unmap the segment, and remove it if it was created by this object
+    void close();
+    //! Check if a segment is mapped
+    bool isOpen() const;
+
+    //! Write a new simulation time and increment the tick counter
+    void write(const ros::Time &time);
+
+    /** \brief Read the latest simulation time and tick counter
+     *
+     * Returns false if nothing has been written yet or if the writer was
+     * writing at the same time, in which case it should be tried again.
+     */
+    bool read(ros::Time &time, uint64_t &ticks) const;
+
+    //! Acknowledge that the tick \a ticks has been processed
+    void acknowledge(uint64_t ticks);
+    //! Get the last acknowledged tick
+    uint64_t acknowledged() const;
+
+  private:
+    SimClockShm(SimClockShm const&);
+    void operator=(SimClockShm const&);
+
+    //! Layout of the shared memory segment
+    struct Data {
+      volatile uint32_t magic;
+      //! Size of this structure, to reject segments with another layout
+      volatile uint32_t size;
+      //! Odd while the writer updates the time
+      volatile uint32_t sequence;
+      volatile uint32_t sec;
+      volatile uint32_t nsec;
+      volatile uint64_t ticks;
+      volatile uint64_t acknowledged;
+    };
+
+    bool map(const std::string &name, bool create);
+
+    std::string name_;
+    bool owner_;
+    Data *data_;
+  };
+}
+
+#endif // ifndef __RTT_ROSCLOCK_SIM_CLOCK_SHM_H
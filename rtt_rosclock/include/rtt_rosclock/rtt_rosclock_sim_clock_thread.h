@@ -42,6 +42,7 @@
 #define __RTT_ROSCLOCK_SIM_CLOCK_THREAD_H
 
 #include <rtt/Service.hpp>
+#include <rtt/os/Atomic.hpp>
 #include <rtt/os/Thread.hpp>
 #include <rtt/os/TimeService.hpp>
 
@@ -51,6 +52,8 @@
 
 #include <rosgraph_msgs/Clock.h>
 
+#include <rtt_rosclock/rtt_rosclock_sim_clock_shm.h>
+
 namespace rtt_rosclock {
 
   /** 
@@ -72,7 +75,8 @@ namespace rtt_rosclock {
     //! Simulation clock sources
     enum SimClockSource {
       SIM_CLOCK_SOURCE_MANUAL = 0,
-      SIM_CLOCK_SOURCE_ROS_CLOCK_TOPIC = 1
+      SIM_CLOCK_SOURCE_ROS_CLOCK_TOPIC = 1,
+      SIM_CLOCK_SOURCE_SHARED_MEMORY = 2
     };
 
     //! Set the simulation clock source by ID (see ClockSource enum)
@@ -81,10 +85,50 @@ namespace rtt_rosclock {
     bool useROSClockTopic();
     //! Set the clock source to use a manual source, i.e. call `updateClock()` manually
     bool useManualClock();
+    //! Set the clock source to poll the shared memory clock \a name (see SimClockShm)
+    bool useSharedMemoryClock(const std::string &name);
 
     //! Check if simulation time is enabled
     bool simTimeEnabled() const;
 
+    /**
+     * Check if simulation time is enabled, without getting the singleton
+     *
+     * This only reads a flag which is set once the thread has been
+     * initialized and cleared before it is finalized, so it is cheap enough
+     * to be called whenever a time stamp is taken.
+     */
+    static bool SimTimeEnabled();
+
+    /**
+     * Acknowledge each processed clock update on a ROS topic
+     *
+     * In lock-step mode, the simulation time is published on \a topic as a
+     * rosgraph_msgs/Clock message after all SimClockActivities due at a clock
+     * update have been executed. A simulator can wait for it before it
+     * publishes the next time, so that it runs exactly as fast as the slowest
+     * component allows. An empty topic disables the lock-step mode. It cannot
+     * be changed while the simulation clock is enabled.
+     */
+    bool setLockStepTopic(const std::string &topic);
+    //! Get the topic on which clock updates are acknowledged, or an empty string
+    const std::string &getLockStepTopic() const;
+
+    /**
+     * Clock ticks received from the clock source since the thread was started
+     *
+     * Ticks are coalesced if several /clock messages arrive before the thread
+     * could process the first one, in which case only the latest time is
+     * processed. Ticks are dropped if the shared memory clock has been
+     * written more than once between two polls. Dropped ticks are not
+     * counted for the /clock topic, since they never reach this thread.
+     */
+    unsigned long getReceivedTicks() const;
+    //! Clock ticks which have been skipped in favor of a later one (see getReceivedTicks())
+    unsigned long getCoalescedTicks() const;
+    //! Clock ticks which have been overwritten before they were read (see getReceivedTicks())
+    unsigned long getDroppedTicks() const;
+
     /**
      * Update the RTT clock and SimClockActivities with a new time
      *
@@ -105,6 +149,9 @@ namespace rtt_rosclock {
     //! SimClockThread singleton
     static boost::shared_ptr<SimClockThread> singleton;
 
+    //! True while the simulation time overrides the RTT clock (see SimTimeEnabled())
+    static volatile bool sim_time_enabled;
+
     //! Re-set the RTT::os::TimeService to zero and restart logging
     void resetTimeService();
 
@@ -132,8 +179,31 @@ namespace rtt_rosclock {
     ros::Subscriber clock_subscriber_;
     //! Custom callback queue used in this thread
     ros::CallbackQueue callback_queue_;
+    //! Topic on which clock updates are acknowledged in lock-step mode
+    std::string lock_step_topic_;
+    //! ROS publisher of the acknowledgements in lock-step mode
+    ros::Publisher lock_step_publisher_;
+    //! Acknowledge the clock update to \a time if lock-step mode is enabled
+    void acknowledge(const ros::Time &time);
     //! ROS message callback for /clock topic
     void clockMsgCallback(const rosgraph_msgs::ClockConstPtr& clock);
+
+    //! Latest time received from the /clock topic which has not been processed yet
+    ros::Time pending_time_;
+    //! True if pending_time_ has to be processed
+    bool pending_;
+
+    //! Name of the shared memory clock
+    std::string shm_name_;
+    //! Shared memory clock polled by this thread
+    SimClockShm shm_;
+    //! Tick counter of the last time read from the shared memory clock
+    uint64_t shm_ticks_;
+
+    //! Counters of clock ticks (see getReceivedTicks()), which are read by other threads
+    RTT::os::AtomicInt received_ticks_;
+    RTT::os::AtomicInt coalesced_ticks_;
+    RTT::os::AtomicInt dropped_ticks_;
   };
 
 }
@@ -4,16 +4,23 @@
 
 #include <rtt_rosclock/rtt_rosclock.h>
 #include <rtt_rosclock/rtt_rosclock_sim_clock_activity.h>
+#include <rtt_rosclock/rtt_rosclock_sim_clock_activity_manager.h>
 #include <rtt_rosclock/rtt_rosclock_sim_clock_thread.h>
+#include <rtt_rosclock/rtt_rosclock_high_resolution_clock.h>
+#include <rtt_rosclock/rtt_rosclock_offset_estimator.h>
+#include <rtt_rosclock/rtt_rosclock_profiler.h>
 
 namespace rtt_rosclock {
   boost::shared_ptr<rtt_rosclock::SimClockThread> sim_clock_thread;
+
+  //! True if the host clock is read from the HighResolutionClock
+  volatile bool use_high_resolution_clock = false;
 }
 
 const ros::Time rtt_rosclock::host_now()
 {
-  boost::shared_ptr<SimClockThread> instance = SimClockThread::GetInstance();
-  if(instance && instance->simTimeEnabled()) {
+  // Don't copy the singleton here, this is called for every time stamp
+  if(SimClockThread::SimTimeEnabled()) {
     return rtt_now();
   }
 
@@ -28,6 +35,9 @@ const ros::Time rtt_rosclock::host_now()
 
     return ros::Time(ts.tv_sec, ts.tv_nsec);
   #else
+    if(use_high_resolution_clock && !ros::Time::isSimTime()) {
+      return HighResolutionClock::Instance().now();
+    }
     return ros::Time::now();
   #endif
 }
@@ -45,6 +55,9 @@ const ros::Time rtt_rosclock::host_wall_now()
 
     return ros::Time(ts.tv_sec, ts.tv_nsec);
   #else
+    if(use_high_resolution_clock) {
+      return HighResolutionClock::Instance().now();
+    }
     ros::WallTime now(ros::WallTime::now());
     return ros::Time(now.sec, now.nsec);
   #endif
@@ -79,7 +92,59 @@ const ros::Time rtt_rosclock::rtt_wall_now()
 
 const RTT::Seconds rtt_rosclock::host_offset_from_rtt()
 {
-  return (rtt_rosclock::host_wall_now() - rtt_rosclock::rtt_wall_now()).toSec();
+  // Compare the RTT clock with the middle of two host clock reads, so the
+  // time it takes to read the clocks does not bias the offset
+  const ros::Time host_before = rtt_rosclock::host_wall_now();
+  const ros::Time rtt = rtt_rosclock::rtt_wall_now();
+  const ros::Time host_after = rtt_rosclock::host_wall_now();
+
+  return (host_before - rtt).toSec() + 0.5 * (host_after - host_before).toSec();
+}
+
+const bool rtt_rosclock::enable_host_offset_estimator()
+{
+  return OffsetEstimator::Instance()->start();
+}
+
+const bool rtt_rosclock::disable_host_offset_estimator()
+{
+  return OffsetEstimator::Instance()->stop();
+}
+
+const RTT::Seconds rtt_rosclock::host_offset_estimate()
+{
+  if(OffsetEstimator::HasEstimate()) {
+    return OffsetEstimator::GetOffset();
+  }
+  return host_offset_from_rtt();
+}
+
+const ros::Time rtt_rosclock::host_from_rtt(const ros::Time rtt_time)
+{
+  if(OffsetEstimator::HasEstimate()) {
+    return OffsetEstimator::HostFromRTT(rtt_time);
+  }
+  return rtt_time + ros::Duration(host_offset_from_rtt());
+}
+
+const bool rtt_rosclock::use_high_resolution_host_clock()
+{
+#ifdef __XENO__
+  RTT::log(RTT::Warning) << "The high resolution host clock is not used under Xenomai, which provides CLOCK_HOST_REALTIME." << RTT::endlog();
+  return false;
+#else
+  HighResolutionClock &clock = HighResolutionClock::Instance();
+  if(!clock.isCalibrated() && !clock.calibrate()) {
+    return false;
+  }
+  use_high_resolution_clock = true;
+  return true;
+#endif
+}
+
+void rtt_rosclock::use_ros_host_clock()
+{
+  use_high_resolution_clock = false;
 }
 
 void rtt_rosclock::use_ros_clock_topic()
@@ -92,12 +157,88 @@ void rtt_rosclock::use_manual_clock()
   SimClockThread::Instance()->useManualClock();
 }
 
+const bool rtt_rosclock::use_shared_memory_clock(const std::string &name)
+{
+  return SimClockThread::Instance()->useSharedMemoryClock(name);
+}
+
+const bool rtt_rosclock::set_sim_clock_thread_scheduler(const int scheduler, const int priority)
+{
+  boost::shared_ptr<SimClockThread> thread = SimClockThread::Instance();
+  return thread->setScheduler(scheduler) && thread->setPriority(priority);
+}
+
+const bool rtt_rosclock::set_sim_clock_thread_cpu_affinity(const unsigned int cpus)
+{
+  return SimClockThread::Instance()->setCpuAffinity(cpus);
+}
+
+const unsigned int rtt_rosclock::get_sim_clock_received_ticks()
+{
+  return SimClockThread::Instance()->getReceivedTicks();
+}
+
+const unsigned int rtt_rosclock::get_sim_clock_coalesced_ticks()
+{
+  return SimClockThread::Instance()->getCoalescedTicks();
+}
+
+const unsigned int rtt_rosclock::get_sim_clock_dropped_ticks()
+{
+  return SimClockThread::Instance()->getDroppedTicks();
+}
+
 const bool rtt_rosclock::set_sim_clock_activity(RTT::TaskContext *t)
 {
   if (!t) return false;
   return t->setActivity(new SimClockActivity(t->getPeriod()));
 }
 
+const bool rtt_rosclock::set_sim_clock_group(RTT::TaskContext *t, const std::string &group)
+{
+  if (!t) return false;
+  SimClockActivity *activity = dynamic_cast<SimClockActivity *>(t->getActivity());
+  if (!activity) {
+    RTT::log(RTT::Error) << "TaskContext \"" << t->getName() << "\" does not have a SimClockActivity." << RTT::endlog();
+    return false;
+  }
+  activity->setGroup(group);
+  return true;
+}
+
+const bool rtt_rosclock::add_sim_clock_dependency(RTT::TaskContext *before, RTT::TaskContext *after)
+{
+  if (!before || !after) return false;
+  SimClockActivity *before_activity = dynamic_cast<SimClockActivity *>(before->getActivity());
+  SimClockActivity *after_activity = dynamic_cast<SimClockActivity *>(after->getActivity());
+  if (!before_activity || !after_activity) {
+    RTT::log(RTT::Error) << "TaskContexts \"" << before->getName() << "\" and \"" << after->getName() << "\" must both have a SimClockActivity." << RTT::endlog();
+    return false;
+  }
+  SimClockActivityManager::Instance()->addDependency(before_activity, after_activity);
+  return true;
+}
+
+void rtt_rosclock::derive_sim_clock_dependencies()
+{
+  SimClockActivityManager::Instance()->deriveDependencies();
+}
+
+void rtt_rosclock::set_sim_clock_threads(const unsigned int n)
+{
+  SimClockActivityManager::Instance()->setThreads(n);
+}
+
+const unsigned int rtt_rosclock::get_sim_clock_threads()
+{
+  return SimClockActivityManager::Instance()->getThreads();
+}
+
+const bool rtt_rosclock::set_sim_clock_lock_step_topic(const std::string &topic)
+{
+  return SimClockThread::Instance()->setLockStepTopic(topic);
+}
+
 const bool rtt_rosclock::enable_sim()
 {
   return SimClockThread::Instance()->start();
@@ -112,3 +253,43 @@ void rtt_rosclock::update_sim_clock(const ros::Time new_time)
 {
   SimClockThread::Instance()->updateClock(new_time);
 }
+
+const bool rtt_rosclock::enable_profiler()
+{
+  return Profiler::Instance()->start();
+}
+
+const bool rtt_rosclock::disable_profiler()
+{
+  return Profiler::Instance()->stop();
+}
+
+const bool rtt_rosclock::set_profiler_topic(const std::string &topic)
+{
+  return Profiler::Instance()->setTopic(topic);
+}
+
+const unsigned int rtt_rosclock::add_profile_section(const std::string &name)
+{
+  return Profiler::Instance()->addSection(name);
+}
+
+const std::vector<std::string> rtt_rosclock::get_profile_sections()
+{
+  return Profiler::Instance()->getSections();
+}
+
+const double rtt_rosclock::get_profile_mean(const std::string &section)
+{
+  return Profiler::Instance()->getMean(section);
+}
+
+const double rtt_rosclock::get_profile_percentile(const std::string &section, const double p)
+{
+  return Profiler::Instance()->getPercentile(section, p);
+}
+
+const unsigned int rtt_rosclock::get_profiler_dropped_timings()
+{
+  return Profiler::Instance()->getDroppedTimings();
+}
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cmath>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+#include <rtt/Logger.hpp>
+
+#include <rtt_rosclock/rtt_rosclock_high_resolution_clock.h>
+
+using namespace rtt_rosclock;
+
+const double HighResolutionClock::CALIBRATION_TIME = 0.05;
+const double HighResolutionClock::DISCIPLINE_PERIOD = 1.0;
+const double HighResolutionClock::MAX_SLEW_RATE = 500e-6;
+const double HighResolutionClock::MAX_SLEW_ERROR = 0.1;
+
+namespace {
+  const int64_t one_E9 = 1000000000LL;
+
+  int64_t clockNSecs(clockid_t clock)
+  {
+    timespec ts = {0, 0};
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * one_E9 + ts.tv_nsec;
+  }
+
+  //! Check if the CPU has a time stamp counter which runs at a constant rate in all power states
+  bool hasInvariantTSC()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+      return false;
+    }
+    return (edx & (1 << 8)) != 0;
+#else
+    return false;
+#endif
+  }
+}
+
+HighResolutionClock &HighResolutionClock::Instance()
+{
+  static HighResolutionClock clock;
+  return clock;
+}
+
+HighResolutionClock::HighResolutionClock() :
+  counter_(COUNTER_MONOTONIC_RAW),
+  calibrated_(false),
+  nominal_ns_per_count_(1.0),
+  discipline_counts_(0),
+  sequence_(0),
+  next_discipline_(0),
+  disciplining_(0),
+  error_ns_(0)
+{
+  conversion_.base_count = 0;
+  conversion_.base_ns = 0;
+  conversion_.ns_per_count = 1.0;
+}
+
+bool HighResolutionClock::calibrate()
+{
+  timespec ts;
+  if(clock_gettime(CLOCK_MONOTONIC_RAW, &ts) != 0) {
+    RTT::log(RTT::Error) << "CLOCK_MONOTONIC_RAW is not available." << RTT::endlog();
+    return false;
+  }
+
+  if(hasInvariantTSC()) {
+    // Measure the rate of the TSC against CLOCK_MONOTONIC_RAW
+    counter_ = COUNTER_TSC;
+    const int64_t ns0 = clockNSecs(CLOCK_MONOTONIC_RAW);
+    const uint64_t count0 = this->count();
+
+    const timespec calibration_time = { 0, static_cast<long>(CALIBRATION_TIME * one_E9) };
+    nanosleep(&calibration_time, NULL);
+
+    const int64_t ns1 = clockNSecs(CLOCK_MONOTONIC_RAW);
+    const uint64_t count1 = this->count();
+
+    nominal_ns_per_count_ = static_cast<double>(ns1 - ns0) / static_cast<double>(count1 - count0);
+  } else {
+    RTT::log(RTT::Info) << "The CPU does not have an invariant time stamp counter, using CLOCK_MONOTONIC_RAW." << RTT::endlog();
+    counter_ = COUNTER_MONOTONIC_RAW;
+    nominal_ns_per_count_ = 1.0;
+  }
+
+  discipline_counts_ = static_cast<uint64_t>(DISCIPLINE_PERIOD * one_E9 / nominal_ns_per_count_);
+
+  // Start at CLOCK_REALTIME
+  const uint64_t count = this->count();
+  sequence_++;
+  __sync_synchronize();
+  conversion_.base_count = count;
+  conversion_.base_ns = clockNSecs(CLOCK_REALTIME);
+  conversion_.ns_per_count = nominal_ns_per_count_;
+  __sync_synchronize();
+  sequence_++;
+
+  next_discipline_ = count + discipline_counts_;
+  error_ns_ = 0;
+  calibrated_ = true;
+
+  RTT::log(RTT::Debug) << "[rtt_rosclock] Calibrated the high resolution clock to " << this->getFrequency() << " counts per second." << RTT::endlog();
+
+  return true;
+}
+
+bool HighResolutionClock::isCalibrated() const
+{
+  return calibrated_;
+}
+
+HighResolutionClock::Counter HighResolutionClock::getCounter() const
+{
+  return counter_;
+}
+
+double HighResolutionClock::getFrequency() const
+{
+  return one_E9 / nominal_ns_per_count_;
+}
+
+double HighResolutionClock::getError() const
+{
+  return static_cast<double>(error_ns_) / one_E9;
+}
+
+uint64_t HighResolutionClock::count() const
+{
+#if defined(__x86_64__) || defined(__i386__)
+  if(counter_ == COUNTER_TSC) {
+    return __rdtsc();
+  }
+#endif
+  return clockNSecs(CLOCK_MONOTONIC_RAW);
+}
+
+const ros::Time HighResolutionClock::now()
+{
+  const uint64_t count = this->count();
+
+  // Read the conversion consistently
+  Conversion conversion;
+  uint32_t sequence;
+  do {
+    sequence = sequence_;
+    __sync_synchronize();
+    conversion = conversion_;
+    __sync_synchronize();
+  } while((sequence & 1) || sequence != sequence_);
+
+  // The conversion may have been moved past the count by another thread
+  int64_t ns = conversion.base_ns;
+  if(count > conversion.base_count) {
+    ns += static_cast<int64_t>(static_cast<double>(count - conversion.base_count) * conversion.ns_per_count);
+  }
+
+  if(count >= next_discipline_ && __sync_bool_compare_and_swap(&disciplining_, 0, 1)) {
+    this->discipline(count, ns);
+    disciplining_ = 0;
+  }
+
+  return ros::Time(ns / one_E9, ns % one_E9);
+}
+
+void HighResolutionClock::discipline(uint64_t count, int64_t ns)
+{
+  // Another thread may have adjusted the clock since the count was read
+  if(count < next_discipline_) {
+    return;
+  }
+
+  const int64_t error = clockNSecs(CLOCK_REALTIME) - ns;
+  error_ns_ = error;
+
+  Conversion conversion;
+  conversion.base_count = count;
+  if(std::fabs(static_cast<double>(error)) > MAX_SLEW_ERROR * one_E9) {
+    // Step to CLOCK_REALTIME
+    conversion.base_ns = ns + error;
+    conversion.ns_per_count = nominal_ns_per_count_;
+  } else {
+    // Correct the error over the next period, without jumping
+    double slew = static_cast<double>(error) / (DISCIPLINE_PERIOD * one_E9);
+    slew = std::max(-MAX_SLEW_RATE, std::min(MAX_SLEW_RATE, slew));
+    conversion.base_ns = ns;
+    conversion.ns_per_count = nominal_ns_per_count_ * (1.0 + slew);
+  }
+
+  sequence_++;
+  __sync_synchronize();
+  conversion_ = conversion;
+  __sync_synchronize();
+  sequence_++;
+
+  next_discipline_ = count + discipline_counts_;
+}
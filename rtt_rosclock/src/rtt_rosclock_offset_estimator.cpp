@@ -0,0 +1,162 @@
+#include <cmath>
+
+#include <rtt/Logger.hpp>
+#include <rtt/os/StartStopManager.hpp>
+
+#include <rtt_rosclock/rtt_rosclock.h>
+#include <rtt_rosclock/rtt_rosclock_offset_estimator.h>
+
+using namespace rtt_rosclock;
+
+const double OffsetEstimator::PERIOD = 0.1;
+const unsigned int OffsetEstimator::SAMPLES = 8;
+const double OffsetEstimator::DRIFT = 1e-6;
+
+namespace {
+  const int64_t one_E9 = 1000000000LL;
+  //! Standard deviation of a sample which took no time, from the resolution of the clocks
+  const double RESOLUTION = 1e-7;
+}
+
+boost::shared_ptr<OffsetEstimator> OffsetEstimator::singleton;
+volatile uint32_t OffsetEstimator::sequence = 0;
+volatile int64_t OffsetEstimator::offset_ns = 0;
+volatile double OffsetEstimator::uncertainty = 0.0;
+volatile bool OffsetEstimator::has_estimate = false;
+
+boost::shared_ptr<OffsetEstimator> OffsetEstimator::GetInstance()
+{
+  return singleton;
+}
+
+boost::shared_ptr<OffsetEstimator> OffsetEstimator::Instance()
+{
+  // Create a new singleton, if necessary
+  boost::shared_ptr<OffsetEstimator> shared = GetInstance();
+  if(!shared) {
+    shared.reset(new OffsetEstimator());
+    singleton = shared;
+  }
+
+  return shared;
+}
+
+void OffsetEstimator::Release()
+{
+  singleton.reset();
+}
+
+namespace {
+  RTT::os::CleanupFunction cleanup(&OffsetEstimator::Release);
+}
+
+OffsetEstimator::OffsetEstimator()
+  : RTT::os::Thread(ORO_SCHED_OTHER, RTT::os::LowestPriority, PERIOD, 0, "rtt_rosclock_OffsetEstimator")
+  , initialized_(false)
+  , base_offset_(0)
+  , offset_(0.0)
+  , variance_(0.0)
+{
+}
+
+OffsetEstimator::~OffsetEstimator()
+{
+  this->stop();
+}
+
+bool OffsetEstimator::HasEstimate()
+{
+  return has_estimate;
+}
+
+int64_t OffsetEstimator::ReadOffset()
+{
+  int64_t offset;
+  uint32_t start;
+  do {
+    start = sequence;
+    __sync_synchronize();
+    offset = offset_ns;
+    __sync_synchronize();
+  } while((start & 1) || start != sequence);
+
+  return offset;
+}
+
+RTT::Seconds OffsetEstimator::GetOffset()
+{
+  return static_cast<double>(ReadOffset()) / one_E9;
+}
+
+RTT::Seconds OffsetEstimator::GetUncertainty()
+{
+  return uncertainty;
+}
+
+const ros::Time OffsetEstimator::HostFromRTT(const ros::Time &rtt_time)
+{
+  int64_t ns = static_cast<int64_t>(rtt_time.sec) * one_E9 + rtt_time.nsec + ReadOffset();
+  return ros::Time(ns / one_E9, ns % one_E9);
+}
+
+bool OffsetEstimator::initialize()
+{
+  // Start the filter over, the first step publishes a new estimate
+  initialized_ = false;
+  return true;
+}
+
+void OffsetEstimator::step()
+{
+  // Keep the sample for which reading the clocks took the shortest time
+  int64_t best_offset = 0;
+  int64_t best_duration = -1;
+
+  for(unsigned int i=0; i < SAMPLES; i++) {
+    const ros::Time host_before = rtt_rosclock::host_wall_now();
+    const ros::Time rtt = rtt_rosclock::rtt_wall_now();
+    const ros::Time host_after = rtt_rosclock::host_wall_now();
+
+    const int64_t duration = (host_after - host_before).toNSec();
+    if(best_duration < 0 || duration < best_duration) {
+      best_duration = duration;
+      best_offset = (host_before - rtt).toNSec() + duration / 2;
+    }
+  }
+
+  // The RTT clock was read somewhere between the two host clock reads
+  const double half_duration = 0.5 * best_duration / one_E9;
+  const double measurement_variance = half_duration * half_duration + RESOLUTION * RESOLUTION;
+
+  // The filter works relative to the first sample, so that the precision of
+  // the offset does not depend on how far apart the clocks are
+  const double measurement = static_cast<double>(best_offset - base_offset_) / one_E9;
+
+  if(!initialized_ || std::fabs(measurement - offset_) > 1.0) {
+    // Start over, also if one of the clocks has been set
+    base_offset_ = best_offset;
+    offset_ = 0.0;
+    variance_ = measurement_variance;
+    initialized_ = true;
+  } else {
+    variance_ += DRIFT * DRIFT;
+    const double gain = variance_ / (variance_ + measurement_variance);
+    offset_ += gain * (measurement - offset_);
+    variance_ *= 1.0 - gain;
+  }
+
+  sequence++;
+  __sync_synchronize();
+  offset_ns = base_offset_ + static_cast<int64_t>(offset_ * one_E9);
+  uncertainty = std::sqrt(variance_);
+  __sync_synchronize();
+  sequence++;
+
+  has_estimate = true;
+}
+
+void OffsetEstimator::finalize()
+{
+  // The clocks keep drifting apart, so the last estimate goes stale
+  has_estimate = false;
+}
@@ -0,0 +1,373 @@
+#include <sstream>
+
+#include <rtt/Logger.hpp>
+#include <rtt/os/MutexLock.hpp>
+#include <rtt/os/StartStopManager.hpp>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+#include <rtt_rosclock/rtt_rosclock.h>
+#include <rtt_rosclock/rtt_rosclock_profiler.h>
+
+using namespace rtt_rosclock;
+
+const double Profiler::PERIOD = 1.0;
+const double Profiler::DRAIN_PERIOD = 0.01;
+// Enough for a thread recording 400000 timings per second
+const unsigned int Profiler::BUFFER_SIZE = 4096;
+const unsigned int Profiler::CAPACITY = 10000;
+
+namespace {
+
+  //! A timing of a section
+  struct Timing {
+    unsigned int section;
+    ros::Time tic;
+    ros::Time toc;
+  };
+
+  //! Ring buffer of timings with a single writer and a single reader
+  struct ThreadBuffer {
+    ThreadBuffer() : timings(Profiler::BUFFER_SIZE), head(0), tail(0), dropped(0) { }
+
+    std::vector<Timing> timings;
+    //! Number of timings written, only changed by the thread owning the buffer
+    volatile uint64_t head;
+    //! Number of timings read, only changed by the profiler
+    volatile uint64_t tail;
+    volatile unsigned long dropped;
+  };
+
+  //! Buffers of all registered threads. They live as long as the process.
+  std::vector<ThreadBuffer *> thread_buffers;
+  RTT::os::Mutex thread_buffers_mutex;
+
+  //! The buffer of the calling thread
+  __thread ThreadBuffer *thread_buffer = NULL;
+
+  //! Number of timings recorded by threads which have not been registered
+  volatile unsigned long unregistered_timings = 0;
+
+  std::string toString(double value)
+  {
+    std::ostringstream stream;
+    stream << value;
+    return stream.str();
+  }
+
+  diagnostic_msgs::KeyValue keyValue(const std::string &key, const std::string &value)
+  {
+    diagnostic_msgs::KeyValue key_value;
+    key_value.key = key;
+    key_value.value = value;
+    return key_value;
+  }
+}
+
+boost::shared_ptr<Profiler> Profiler::singleton;
+volatile bool Profiler::enabled = false;
+
+boost::shared_ptr<Profiler> Profiler::GetInstance()
+{
+  return singleton;
+}
+
+boost::shared_ptr<Profiler> Profiler::Instance()
+{
+  // Create a new singleton, if necessary
+  boost::shared_ptr<Profiler> shared = GetInstance();
+  if(!shared) {
+    shared.reset(new Profiler());
+    singleton = shared;
+  }
+
+  return shared;
+}
+
+void Profiler::Release()
+{
+  singleton.reset();
+}
+
+namespace {
+  RTT::os::CleanupFunction cleanup(&Profiler::Release);
+}
+
+Profiler::Profiler()
+  : RTT::os::Thread(ORO_SCHED_OTHER, RTT::os::LowestPriority, DRAIN_PERIOD, 0, "rtt_rosclock_Profiler")
+  , window_(10.0)
+  , drains_(0)
+  , topic_("/diagnostics")
+{
+}
+
+Profiler::~Profiler()
+{
+  this->stop();
+}
+
+unsigned int Profiler::addSection(const std::string &name)
+{
+  RTT::os::MutexLock lock(sections_mutex_);
+
+  std::map<std::string, unsigned int>::const_iterator it = section_ids_.find(name);
+  if(it != section_ids_.end()) {
+    return it->second;
+  }
+
+  Section section;
+  section.name = name;
+  section.prof.reset(new WallProf(window_, CAPACITY));
+  sections_.push_back(section);
+
+  const unsigned int id = sections_.size() - 1;
+  section_ids_[name] = id;
+
+  return id;
+}
+
+std::vector<std::string> Profiler::getSections()
+{
+  RTT::os::MutexLock lock(sections_mutex_);
+
+  std::vector<std::string> names;
+  for(std::vector<Section>::const_iterator it = sections_.begin(); it != sections_.end(); ++it) {
+    names.push_back(it->name);
+  }
+  return names;
+}
+
+bool Profiler::setTopic(const std::string &topic)
+{
+  // Don't allow changing the topic while running
+  if(this->isActive()) {
+    RTT::log(RTT::Error) << "The profiler topic cannot be changed while the profiler is running." << RTT::endlog();
+    return false;
+  }
+
+  topic_ = topic;
+
+  return true;
+}
+
+bool Profiler::setWindow(double window)
+{
+  if(this->isActive()) {
+    RTT::log(RTT::Error) << "The profiler window cannot be changed while the profiler is running." << RTT::endlog();
+    return false;
+  }
+
+  RTT::os::MutexLock lock(sections_mutex_);
+
+  window_ = window;
+  for(std::vector<Section>::iterator it = sections_.begin(); it != sections_.end(); ++it) {
+    it->prof.reset(new WallProf(window_, CAPACITY));
+  }
+
+  return true;
+}
+
+WallProf *Profiler::find(const std::string &section)
+{
+  std::map<std::string, unsigned int>::const_iterator it = section_ids_.find(section);
+  if(it == section_ids_.end()) {
+    return NULL;
+  }
+  return sections_[it->second].prof.get();
+}
+
+double Profiler::getMean(const std::string &section)
+{
+  RTT::os::MutexLock lock(sections_mutex_);
+
+  WallProf *prof = this->find(section);
+  if(!prof) {
+    return 0.0;
+  }
+  prof->analyze();
+  return prof->mean();
+}
+
+double Profiler::getPercentile(const std::string &section, double p)
+{
+  RTT::os::MutexLock lock(sections_mutex_);
+
+  WallProf *prof = this->find(section);
+  if(!prof) {
+    return 0.0;
+  }
+  return prof->percentile(p);
+}
+
+unsigned int Profiler::getDroppedTimings() const
+{
+  RTT::os::MutexLock lock(thread_buffers_mutex);
+
+  unsigned long dropped = unregistered_timings;
+  for(std::vector<ThreadBuffer *>::const_iterator it = thread_buffers.begin(); it != thread_buffers.end(); ++it) {
+    dropped += (*it)->dropped;
+  }
+  return dropped;
+}
+
+bool Profiler::Enabled()
+{
+  return enabled;
+}
+
+void Profiler::RegisterThread()
+{
+  if(thread_buffer) {
+    return;
+  }
+
+  ThreadBuffer *buffer = new ThreadBuffer();
+  RTT::os::MutexLock lock(thread_buffers_mutex);
+  thread_buffers.push_back(buffer);
+  thread_buffer = buffer;
+}
+
+void Profiler::Record(unsigned int section, const ros::Time &tic, const ros::Time &toc)
+{
+  if(!enabled) {
+    return;
+  }
+
+  ThreadBuffer *buffer = thread_buffer;
+  if(!buffer) {
+    __sync_fetch_and_add(&unregistered_timings, 1);
+    return;
+  }
+
+  const uint64_t head = buffer->head;
+  if(head - __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE) >= buffer->timings.size()) {
+    buffer->dropped++;
+    return;
+  }
+
+  Timing &timing = buffer->timings[head % buffer->timings.size()];
+  timing.section = section;
+  timing.tic = tic;
+  timing.toc = toc;
+
+  // Publish the timing with the head
+  __atomic_store_n(&buffer->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void Profiler::drain()
+{
+  RTT::os::MutexLock buffers_lock(thread_buffers_mutex);
+
+  for(std::vector<ThreadBuffer *>::iterator it = thread_buffers.begin(); it != thread_buffers.end(); ++it) {
+    ThreadBuffer &buffer = **it;
+    const uint64_t head = __atomic_load_n(&buffer.head, __ATOMIC_ACQUIRE);
+
+    for(uint64_t i = buffer.tail; i < head; i++) {
+      const Timing &timing = buffer.timings[i % buffer.timings.size()];
+      if(timing.section < sections_.size()) {
+        sections_[timing.section].prof->add(timing.tic, timing.toc);
+      }
+    }
+
+    // Release the timings to the writer
+    __atomic_store_n(&buffer.tail, head, __ATOMIC_RELEASE);
+  }
+}
+
+bool Profiler::initialize()
+{
+  // Only create a NodeHandle if the statistics are published
+  if(!topic_.empty()) {
+    ros::NodeHandle nh;
+    publisher_ = nh.advertise<diagnostic_msgs::DiagnosticArray>(topic_, 1);
+  }
+
+  drains_ = 0;
+  enabled = true;
+
+  return true;
+}
+
+void Profiler::step()
+{
+  diagnostic_msgs::DiagnosticArray statistics;
+
+  {
+    RTT::os::MutexLock lock(sections_mutex_);
+
+    this->drain();
+
+    // Publish once every PERIOD, starting with the first drain
+    const unsigned int drains_per_period = static_cast<unsigned int>(PERIOD / DRAIN_PERIOD + 0.5);
+    if(drains_++ % drains_per_period != 0 || !publisher_) {
+      return;
+    }
+
+    statistics.header.stamp = rtt_rosclock::host_now();
+    statistics.status.resize(sections_.size());
+
+    for(size_t i = 0; i < sections_.size(); i++) {
+      WallProf &prof = *sections_[i].prof;
+      prof.analyze();
+
+      diagnostic_msgs::DiagnosticStatus &status = statistics.status[i];
+      status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      status.name = "profile: " + sections_[i].name;
+      status.message = "Durations in seconds";
+      status.values.push_back(keyValue("count", toString(prof.n())));
+      status.values.push_back(keyValue("mean", toString(prof.mean())));
+      status.values.push_back(keyValue("stddev", toString(prof.stddev())));
+      status.values.push_back(keyValue("min", toString(prof.min())));
+      status.values.push_back(keyValue("p50", toString(prof.percentile(0.5))));
+      status.values.push_back(keyValue("p90", toString(prof.percentile(0.9))));
+      status.values.push_back(keyValue("p99", toString(prof.percentile(0.99))));
+      status.values.push_back(keyValue("max", toString(prof.max())));
+    }
+  }
+
+  publisher_.publish(statistics);
+}
+
+void Profiler::finalize()
+{
+  enabled = false;
+
+  // Keep the last timings in the statistics
+  RTT::os::MutexLock lock(sections_mutex_);
+  this->drain();
+
+  publisher_.shutdown();
+}
+
+ProfileSection::ProfileSection(const std::string &name) :
+  id_(Profiler::Instance()->addSection(name))
+{
+}
+
+void ProfileSection::tic()
+{
+  // Register the thread before its first timing, and not while it is timed
+  if(Profiler::Enabled()) {
+    Profiler::RegisterThread();
+  }
+  tic_ = rtt_rosclock::rtt_wall_now();
+}
+
+void ProfileSection::toc()
+{
+  Profiler::Record(id_, tic_, rtt_rosclock::rtt_wall_now());
+}
+
+ProfileSection::Scope::Scope(ProfileSection &section) :
+  section_(section)
+{
+  if(Profiler::Enabled()) {
+    Profiler::RegisterThread();
+  }
+  tic_ = rtt_rosclock::rtt_wall_now();
+}
+
+ProfileSection::Scope::~Scope()
+{
+  Profiler::Record(section_.id_, tic_, rtt_rosclock::rtt_wall_now());
+}
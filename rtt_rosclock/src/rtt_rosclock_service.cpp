@@ -26,7 +26,7 @@ void loadROSClockService(){
   // Getting current time 
   rosclock->addOperation("host_now", &rtt_rosclock::host_now).doc(
       "Get a ros::Time structure based on the NTP-corrected RT time or the ROS simulation time.");
-  rosclock->addOperation("host_wall_now", &rtt_rosclock::host_now).doc(
+  rosclock->addOperation("host_wall_now", &rtt_rosclock::host_wall_now).doc(
       "Get a ros::Time structure based on the NTP-corrected RT time or the ROS wall time.");
   rosclock->addOperation("rtt_now", &rtt_rosclock::rtt_now).doc(
       "Get a ros::Time structure based on the RTT time source.");
@@ -37,11 +37,46 @@ void loadROSClockService(){
   rosclock->addOperation("host_offset_from_rtt", &rtt_rosclock::host_offset_from_rtt).doc(
       "Get the difference between the Orocos wall clock and the NTP-corrected wall clock in seconds (host_wall - rtt_wall).");
 
+  // Estimating the time offset
+  rosclock->addOperation("enableHostOffsetEstimator", &rtt_rosclock::enable_host_offset_estimator).doc(
+      "Start estimating the offset between the Orocos wall clock and the host wall clock in the background.");
+  rosclock->addOperation("disableHostOffsetEstimator", &rtt_rosclock::disable_host_offset_estimator).doc(
+      "Stop estimating the offset between the Orocos wall clock and the host wall clock.");
+  rosclock->addOperation("host_offset_estimate", &rtt_rosclock::host_offset_estimate).doc(
+      "Get the filtered difference between the Orocos wall clock and the host wall clock in seconds (host_wall - rtt_wall).");
+  rosclock->addOperation("host_from_rtt", &rtt_rosclock::host_from_rtt).doc(
+      "Convert a time stamp of the Orocos wall clock to the host wall clock with the estimated offset.").arg(
+          "rtt_time","A time stamp taken with rtt_wall_now.");
+
+  // Setting the source for the host clock
+  rosclock->addOperation("useHighResolutionHostClock", &rtt_rosclock::use_high_resolution_host_clock).doc(
+      "Read the host clock from the calibrated time stamp counter of the CPU or CLOCK_MONOTONIC_RAW, kept close to CLOCK_REALTIME. Not used under Xenomai.");
+  rosclock->addOperation("useROSHostClock", &rtt_rosclock::use_ros_host_clock).doc(
+      "Read the host clock from ROS, or CLOCK_HOST_REALTIME under Xenomai.");
+
   // Setting the source for the simulation clock
   rosclock->addOperation("useROSClockTopic", &rtt_rosclock::use_ros_clock_topic).doc(
       "Use the ROS /clock topic source for updating simulation time.");
   rosclock->addOperation("useManualClock", &rtt_rosclock::use_manual_clock).doc(
       "Use a manual source for simulation time by calling updateSimClock.");
+  rosclock->addOperation("useSharedMemoryClock", &rtt_rosclock::use_shared_memory_clock).doc(
+      "Use a shared memory clock written by a simulator on the same host as the source for simulation time.").arg(
+          "name","The name of the POSIX shared memory segment.");
+
+  // Latency of the simulation clock
+  rosclock->addOperation("setSimClockThreadScheduler", &rtt_rosclock::set_sim_clock_thread_scheduler).doc(
+      "Set the scheduler and priority of the thread which receives the simulation clock.").arg(
+          "scheduler","ORO_SCHED_OTHER or ORO_SCHED_RT.").arg(
+          "priority","The priority of the thread.");
+  rosclock->addOperation("setSimClockThreadCpuAffinity", &rtt_rosclock::set_sim_clock_thread_cpu_affinity).doc(
+      "Restrict the thread which receives the simulation clock to a set of CPUs.").arg(
+          "cpus","Bit mask of the CPUs.");
+  rosclock->addOperation("getSimClockReceivedTicks", &rtt_rosclock::get_sim_clock_received_ticks).doc(
+      "Get the number of clock ticks received since the simulation clock was enabled.");
+  rosclock->addOperation("getSimClockCoalescedTicks", &rtt_rosclock::get_sim_clock_coalesced_ticks).doc(
+      "Get the number of received clock ticks which were skipped because a later one arrived before they were processed.");
+  rosclock->addOperation("getSimClockDroppedTicks", &rtt_rosclock::get_sim_clock_dropped_ticks).doc(
+      "Get the number of shared memory clock ticks which were overwritten before they were read.");
 
   // Enabling/Disabling simulation clock
   rosclock->addOperation("enableSimClock", &rtt_rosclock::enable_sim).doc(
@@ -49,9 +84,58 @@ void loadROSClockService(){
   rosclock->addOperation("disableSimClock", &rtt_rosclock::disable_sim).doc(
       "Disable simulation time based on the ROS /clock topic.");
 
+  rosclock->addOperation("setSimClockLockStepTopic", &rtt_rosclock::set_sim_clock_lock_step_topic).doc(
+      "Publish the simulation time on a topic once all SimClockActivities have been updated, so that a simulator can wait for them. Call this before enableSimClock.").arg(
+          "topic","The topic of the rosgraph_msgs/Clock acknowledgements, or an empty string to disable them.");
+
   rosclock->addOperation("updateSimClock", &rtt_rosclock::update_sim_clock).doc(
       "Update the current simulation time and update all SimClockActivities as per their respective frequencies.").arg(
           "time","Current simulated time in seconds.");
+
+  // Parallel execution of SimClockActivities
+  rosclock->addOperation("setSimClockThreads", &rtt_rosclock::set_sim_clock_threads).doc(
+      "Set the number of threads which execute the SimClockActivities in parallel on each update. 1 executes them sequentially.").arg(
+          "threads","Number of threads, including the thread updating the simulation clock.");
+  rosclock->addOperation("getSimClockThreads", &rtt_rosclock::get_sim_clock_threads).doc(
+      "Get the number of threads which execute the SimClockActivities.");
+  rosclock->addOperation("setSimClockGroup", &rtt_rosclock::set_sim_clock_group).doc(
+      "Put the SimClockActivity of a task into an ordering group. Tasks in the same group are executed in sequence.").arg(
+          "task","The task, which must have a SimClockActivity.").arg(
+          "group","The name of the group, or an empty string to remove the task from its group.");
+
+  // Execution order of SimClockActivities
+  rosclock->addOperation("addSimClockDependency", &rtt_rosclock::add_sim_clock_dependency).doc(
+      "Declare that a task has to be executed before another one in each simulation step.").arg(
+          "before","The task which is executed first.").arg(
+          "after","The task which is executed after it.");
+  rosclock->addOperation("deriveSimClockDependencies", &rtt_rosclock::derive_sim_clock_dependencies).doc(
+      "Execute tasks with SimClockActivities after the tasks whose output ports are connected to their input ports. Call this after connecting ports.");
+
+  // Profiling of code sections
+  RTT::Service::shared_ptr profile = rosclock->provides("profile");
+  profile->doc("Aggregates the timings of the profiled sections of all components and publishes their statistics.");
+
+  profile->addOperation("enable", &rtt_rosclock::enable_profiler).doc(
+      "Start recording the timings of profiled sections and publishing their statistics.");
+  profile->addOperation("disable", &rtt_rosclock::disable_profiler).doc(
+      "Stop recording the timings of profiled sections.");
+  profile->addOperation("setTopic", &rtt_rosclock::set_profiler_topic).doc(
+      "Set the topic on which the statistics are published as a diagnostic_msgs/DiagnosticArray. Call this before enable.").arg(
+          "topic","The topic, or an empty string to not publish the statistics.");
+  profile->addOperation("addSection", &rtt_rosclock::add_profile_section).doc(
+      "Add a profiled section and get its id.").arg(
+          "name","The name of the section.");
+  profile->addOperation("getSections", &rtt_rosclock::get_profile_sections).doc(
+      "Get the names of all profiled sections.");
+  profile->addOperation("getMean", &rtt_rosclock::get_profile_mean).doc(
+      "Get the mean duration of a profiled section in seconds.").arg(
+          "section","The name of the section.");
+  profile->addOperation("getPercentile", &rtt_rosclock::get_profile_percentile).doc(
+      "Get the duration in seconds below which a fraction of the executions of a profiled section lie.").arg(
+          "section","The name of the section.").arg(
+          "p","The fraction, e.g. 0.99.");
+  profile->addOperation("getDroppedTimings", &rtt_rosclock::get_profiler_dropped_timings).doc(
+      "Get the number of timings which were lost because the buffer of a thread was full or the thread was not registered.");
 }
 
 using namespace RTT;
@@ -88,9 +88,15 @@ RTT::Seconds SimClockActivity::getPeriod() const
     return manager_->getSimulationPeriod();
 }
 
+bool SimClockActivity::followsSimulationPeriod() const
+{
+  return period_ <= 0.0;
+}
+
 bool SimClockActivity::setPeriod(RTT::Seconds s)
 {
   period_ = s;
+  manager_->reschedule();
   return true;
 }
 
@@ -146,6 +152,7 @@ bool SimClockActivity::start()
 
   if ( runner ? runner->initialize() : this->initialize() ) {
     running_ = true;
+    manager_->reschedule();
   } else {
     active_ = false;
   }
@@ -199,3 +206,13 @@ RTT::os::TimeService::ticks SimClockActivity::getLastExecutionTicks() const
 {
   return last_;
 }
+
+void SimClockActivity::setGroup(const std::string &group)
+{
+  manager_->setGroup(this, group);
+}
+
+std::string SimClockActivity::getGroup() const
+{
+  return manager_->getGroup(const_cast<SimClockActivity *>(this));
+}
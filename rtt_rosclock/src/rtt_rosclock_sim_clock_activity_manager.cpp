@@ -42,13 +42,39 @@
 #include <rtt_rosclock/rtt_rosclock_sim_clock_activity_manager.h>
 
 #include <rtt/base/RunnableInterface.hpp>
+#include <rtt/base/InputPortInterface.hpp>
+#include <rtt/base/OutputPortInterface.hpp>
+#include <rtt/internal/ConnFactory.hpp>
+#include <rtt/ExecutionEngine.hpp>
+#include <rtt/TaskContext.hpp>
 #include <rtt/os/TimeService.hpp>
+#include <rtt/os/Time.hpp>
 #include <rtt/Logger.hpp>
 
+#include <boost/bind.hpp>
 #include <boost/weak_ptr.hpp>
 
+#include <algorithm>
+#include <functional>
+
 using namespace rtt_rosclock;
 
+namespace {
+  //! Get the task executed by an activity, if any
+  RTT::TaskContext *getTask(SimClockActivity *activity)
+  {
+    RTT::ExecutionEngine *engine = dynamic_cast<RTT::ExecutionEngine *>(activity->getRunner());
+    return engine ? engine->getParent() : NULL;
+  }
+
+  //! Get the name of the task executed by an activity, for logging
+  std::string getTaskName(SimClockActivity *activity)
+  {
+    RTT::TaskContext *task = getTask(activity);
+    return task ? task->getName() : "(no task)";
+  }
+}
+
 boost::weak_ptr<SimClockActivityManager> SimClockActivityManager::singleton;
 
 boost::shared_ptr<SimClockActivityManager> SimClockActivityManager::GetInstance()
@@ -70,11 +96,21 @@ boost::shared_ptr<SimClockActivityManager> SimClockActivityManager::Instance()
 
 SimClockActivityManager::SimClockActivityManager() 
   : simulation_period_(0.0) 
+  , derive_dependencies_(false)
+  , graph_dirty_(false)
+  , schedule_dirty_(false)
+  , visit_stamp_(0)
+  , n_threads_(1)
+  , n_nodes_(0)
+  , done_nodes_(0)
+  , generation_(0)
+  , stop_workers_(false)
 { 
 }
 
 SimClockActivityManager::~SimClockActivityManager()
 {
+  this->stopWorkers();
 }
 
 RTT::Seconds SimClockActivityManager::getSimulationPeriod() const
@@ -84,32 +120,460 @@ RTT::Seconds SimClockActivityManager::getSimulationPeriod() const
 
 void SimClockActivityManager::setSimulationPeriod(RTT::Seconds s)
 {
+  // The activities which follow the simulation period are due in every
+  // update anyway, so the schedule does not have to be rebuilt
   simulation_period_ = s;
 }
 
+void SimClockActivityManager::reschedule()
+{
+  RTT::os::MutexLock lock(schedule_mutex_);
+  schedule_dirty_ = true;
+}
+
 void SimClockActivityManager::update()
 {
   RTT::os::MutexLock lock(modify_activities_mutex_);
   RTT::os::TimeService::ticks now = RTT::os::TimeService::Instance()->getTicks();
 
-  // Iterate through all activities
-  for(std::list<SimClockActivity *>::const_iterator it = activities_.begin(); it != activities_.end(); it++)
+  // Apply the changes which have been requested since the last update
+  bool derive_dependencies, rebuild_graph, rebuild_schedule;
+  {
+    RTT::os::MutexLock schedule_lock(schedule_mutex_);
+    derive_dependencies = derive_dependencies_;
+    rebuild_graph = graph_dirty_ || derive_dependencies_;
+    rebuild_schedule = schedule_dirty_;
+    derive_dependencies_ = false;
+    graph_dirty_ = false;
+    schedule_dirty_ = false;
+  }
+  if (derive_dependencies) {
+    this->followConnections();
+  }
+  if (rebuild_graph) {
+    this->rebuildGraph();
+    rebuild_schedule = true;
+  }
+  if (rebuild_schedule) {
+    this->rebuildSchedule();
+  }
+
+  // Take the activities which are due at their desired minimum period from
+  // the schedule, in addition to the ones which are due in every update
+  due_.assign(every_update_.begin(), every_update_.end());
+  while (!schedule_.empty() && schedule_.front().first <= now) {
+    std::pop_heap(schedule_.begin(), schedule_.end(), std::greater<Schedule::value_type>());
+    due_.push_back(schedule_.back().second);
+    schedule_.pop_back();
+  }
+  if (due_.empty()) {
+    return;
+  }
+
+  // The nodes are sorted topologically
+  if (due_.size() > every_update_.size()) {
+    std::sort(due_.begin(), due_.end());
+  }
+
+  if (n_threads_ <= 1) {
+    for(std::vector<size_t>::const_iterator it = due_.begin(); it != due_.end(); ++it) {
+      nodes_[*it].activity->execute();
+    }
+  } else {
+    this->executeGraph();
+  }
+
+  // Schedule the next execution of the activities
+  for(std::vector<size_t>::const_iterator it = due_.begin(); it != due_.end(); ++it)
+  {
+    Node &node = nodes_[*it];
+    if (node.every_update) {
+      continue;
+    }
+    node.next_due = node.activity->getLastExecutionTicks() + node.period;
+    if (node.next_due <= now && node.period > 0) {
+      // The activity has not been executed, because it is not running
+      node.next_due = now + node.period;
+    }
+    schedule_.push_back(std::make_pair(node.next_due, *it));
+    std::push_heap(schedule_.begin(), schedule_.end(), std::greater<Schedule::value_type>());
+  }
+}
+
+void SimClockActivityManager::rebuildSchedule()
+{
+  schedule_.clear();
+  every_update_.clear();
+  for(size_t i = 0; i < nodes_.size(); i++)
+  {
+    Node &node = nodes_[i];
+    node.every_update = node.activity->followsSimulationPeriod();
+    if (node.every_update) {
+      node.period = 0;
+      every_update_.push_back(i);
+      continue;
+    }
+    node.period = RTT::os::TimeService::nsecs2ticks(RTT::Seconds_to_nsecs(node.activity->getPeriod()));
+    node.next_due = node.activity->getLastExecutionTicks() + node.period;
+    schedule_.push_back(std::make_pair(node.next_due, i));
+  }
+  std::make_heap(schedule_.begin(), schedule_.end(), std::greater<Schedule::value_type>());
+}
+
+void SimClockActivityManager::executeGraph()
+{
+  // Find the dependencies between the due nodes, also through nodes which are
+  // not due, so that the ordering via them is still respected
+  for(std::vector<size_t>::const_iterator it = due_.begin(); it != due_.end(); ++it) {
+    nodes_[*it].due = true;
+    nodes_[*it].remaining = 0;
+    nodes_[*it].due_successors.clear();
+  }
+  for(std::vector<size_t>::const_iterator it = due_.begin(); it != due_.end(); ++it)
+  {
+    Node &node = nodes_[*it];
+    const unsigned long visit = ++visit_stamp_;
+    search_.assign(node.successors.begin(), node.successors.end());
+    while (!search_.empty())
+    {
+      Node &successor = nodes_[search_.back()];
+      const size_t index = search_.back();
+      search_.pop_back();
+      if (successor.visit == visit) {
+        continue;
+      }
+      successor.visit = visit;
+      if (successor.due) {
+        node.due_successors.push_back(index);
+        successor.remaining++;
+      } else {
+        search_.insert(search_.end(), successor.successors.begin(), successor.successors.end());
+      }
+    }
+  }
+
+  {
+    RTT::os::MutexLock lock(jobs_mutex_);
+
+    ready_.clear();
+    for(std::vector<size_t>::const_iterator it = due_.begin(); it != due_.end(); ++it) {
+      if (nodes_[*it].remaining == 0) {
+        ready_.push_back(*it);
+      }
+    }
+
+    n_nodes_ = due_.size();
+    done_nodes_ = 0;
+    generation_++;
+    jobs_ready_.broadcast();
+  }
+
+  // Help the workers until all nodes have been executed
+  this->runNodes();
+
+  for(std::vector<size_t>::const_iterator it = due_.begin(); it != due_.end(); ++it) {
+    nodes_[*it].due = false;
+  }
+}
+
+void SimClockActivityManager::runNodes()
+{
+  while (true)
+  {
+    size_t index;
+    {
+      RTT::os::MutexLock lock(jobs_mutex_);
+      while (ready_.empty() && done_nodes_ < n_nodes_) {
+        jobs_ready_.wait(jobs_mutex_);
+      }
+      if (done_nodes_ == n_nodes_) {
+        return;
+      }
+      index = ready_.back();
+      ready_.pop_back();
+    }
+
+    Node &node = nodes_[index];
+    node.activity->execute();
+
+    RTT::os::MutexLock lock(jobs_mutex_);
+    for(std::vector<size_t>::const_iterator it = node.due_successors.begin(); it != node.due_successors.end(); ++it) {
+      if (--nodes_[*it].remaining == 0) {
+        ready_.push_back(*it);
+      }
+    }
+    // Wake the threads waiting for ready nodes, or for the end of the update
+    if (++done_nodes_ == n_nodes_ || !ready_.empty()) {
+      jobs_ready_.broadcast();
+    }
+  }
+}
+
+void SimClockActivityManager::workerLoop()
+{
+  unsigned long generation = 0;
+  while (true)
   {
-    // Update this activitiy at its desired minimum period
-    SimClockActivity *activity = *it;
-    if (RTT::os::TimeService::ticks2nsecs(now - activity->getLastExecutionTicks()) * 1e-9 >= activity->getPeriod())
     {
-      activity->execute();
+      RTT::os::MutexLock lock(jobs_mutex_);
+      while (!stop_workers_ && generation == generation_) {
+        jobs_ready_.wait(jobs_mutex_);
+      }
+      if (stop_workers_) {
+        return;
+      }
+      generation = generation_;
     }
+
+    this->runNodes();
   }
 }
 
+void SimClockActivityManager::stopWorkers()
+{
+  if (!workers_) {
+    return;
+  }
+
+  {
+    RTT::os::MutexLock lock(jobs_mutex_);
+    stop_workers_ = true;
+    jobs_ready_.broadcast();
+  }
+  workers_->join_all();
+  workers_.reset();
+
+  RTT::os::MutexLock lock(jobs_mutex_);
+  stop_workers_ = false;
+}
+
+void SimClockActivityManager::setThreads(unsigned int n)
+{
+  RTT::os::MutexLock lock(modify_activities_mutex_);
+
+  this->stopWorkers();
+
+  n_threads_ = std::max(n, 1U);
+  if (n_threads_ > 1) {
+    workers_.reset(new boost::thread_group());
+    for(unsigned int i = 1; i < n_threads_; i++) {
+      workers_->create_thread(boost::bind(&SimClockActivityManager::workerLoop, this));
+    }
+  }
+
+  RTT::log(RTT::Debug) << "Executing SimClockActivities in " << n_threads_ << " threads." << RTT::endlog();
+}
+
+unsigned int SimClockActivityManager::getThreads() const
+{
+  return n_threads_;
+}
+
+void SimClockActivityManager::rebuildGraph()
+{
+  RTT::os::MutexLock lock(schedule_mutex_);
+
+  // Activities in the order in which they were created
+  std::vector<SimClockActivity *> activities(activities_.begin(), activities_.end());
+  std::map<SimClockActivity *, size_t> index;
+  for(size_t i = 0; i < activities.size(); i++) {
+    index[activities[i]] = i;
+  }
+
+  // Collect the edges between the activities
+  std::set<std::pair<size_t, size_t> > edges;
+  const Dependencies *all[] = { &dependencies_, &derived_dependencies_ };
+  for(size_t i = 0; i < 2; i++) {
+    for(Dependencies::const_iterator it = all[i]->begin(); it != all[i]->end(); ++it) {
+      std::map<SimClockActivity *, size_t>::const_iterator before = index.find(it->first);
+      std::map<SimClockActivity *, size_t>::const_iterator after = index.find(it->second);
+      if (before != index.end() && after != index.end()) {
+        edges.insert(std::make_pair(before->second, after->second));
+      }
+    }
+  }
+  std::map<std::string, size_t> last_in_group;
+  for(size_t i = 0; i < activities.size(); i++) {
+    std::map<SimClockActivity *, std::string>::const_iterator group = groups_.find(activities[i]);
+    if (group == groups_.end()) {
+      continue;
+    }
+    std::map<std::string, size_t>::iterator last = last_in_group.find(group->second);
+    if (last != last_in_group.end()) {
+      edges.insert(std::make_pair(last->second, i));
+      last->second = i;
+    } else {
+      last_in_group[group->second] = i;
+    }
+  }
+
+  std::vector<size_t> in_degree(activities.size(), 0);
+  std::vector<std::vector<size_t> > successors(activities.size());
+  for(std::set<std::pair<size_t, size_t> >::const_iterator edge = edges.begin(); edge != edges.end(); ++edge) {
+    if (edge->first != edge->second) {
+      successors[edge->first].push_back(edge->second);
+      in_degree[edge->second]++;
+    }
+  }
+
+  // Sort topologically, preferring the creation order among independent activities
+  std::vector<size_t> order;
+  std::vector<bool> sorted(activities.size(), false);
+  std::set<size_t> ready;
+  for(size_t i = 0; i < activities.size(); i++) {
+    if (in_degree[i] == 0) {
+      ready.insert(i);
+    }
+  }
+  while (order.size() < activities.size())
+  {
+    size_t next;
+    if (!ready.empty()) {
+      next = *ready.begin();
+      ready.erase(ready.begin());
+    } else {
+      // Break a cycle at its earliest created activity
+      next = std::find(sorted.begin(), sorted.end(), false) - sorted.begin();
+      RTT::log(RTT::Warning) << "The dependencies of the SimClockActivity of \"" << getTaskName(activities[next])
+        << "\" form a cycle. Ignoring its dependencies which have not been executed before it." << RTT::endlog();
+    }
+
+    order.push_back(next);
+    sorted[next] = true;
+    for(std::vector<size_t>::const_iterator it = successors[next].begin(); it != successors[next].end(); ++it) {
+      if (!sorted[*it] && --in_degree[*it] == 0) {
+        ready.insert(*it);
+      }
+    }
+  }
+
+  // Build the nodes in topological order, dropping the edges which were ignored
+  std::vector<size_t> position(activities.size());
+  for(size_t i = 0; i < order.size(); i++) {
+    position[order[i]] = i;
+  }
+
+  nodes_.resize(order.size());
+  for(size_t i = 0; i < order.size(); i++) {
+    nodes_[i].activity = activities[order[i]];
+    nodes_[i].successors.clear();
+    nodes_[i].n_predecessors = 0;
+    nodes_[i].remaining = 0;
+    nodes_[i].due = false;
+    nodes_[i].visit = 0;
+    nodes_[i].every_update = false;
+    nodes_[i].period = 0;
+    nodes_[i].next_due = 0;
+  }
+  for(std::set<std::pair<size_t, size_t> >::const_iterator edge = edges.begin(); edge != edges.end(); ++edge) {
+    if (position[edge->first] < position[edge->second]) {
+      nodes_[position[edge->first]].successors.push_back(position[edge->second]);
+      nodes_[position[edge->second]].n_predecessors++;
+    }
+  }
+}
+
+void SimClockActivityManager::addDependency(SimClockActivity *before, SimClockActivity *after)
+{
+  RTT::os::MutexLock lock(schedule_mutex_);
+  dependencies_.insert(std::make_pair(before, after));
+  graph_dirty_ = true;
+}
+
+void SimClockActivityManager::clearDependencies()
+{
+  RTT::os::MutexLock lock(schedule_mutex_);
+  dependencies_.clear();
+  graph_dirty_ = true;
+}
+
+void SimClockActivityManager::deriveDependencies()
+{
+  RTT::os::MutexLock lock(schedule_mutex_);
+  derive_dependencies_ = true;
+}
+
+void SimClockActivityManager::followConnections()
+{
+  // Find the activities of all input ports
+  std::map<const RTT::base::PortInterface *, SimClockActivity *> inputs;
+  for(std::list<SimClockActivity *>::const_iterator it = activities_.begin(); it != activities_.end(); ++it)
+  {
+    RTT::TaskContext *task = getTask(*it);
+    if (!task) {
+      continue;
+    }
+    RTT::DataFlowInterface::Ports ports = task->ports()->getPorts();
+    for(RTT::DataFlowInterface::Ports::const_iterator port = ports.begin(); port != ports.end(); ++port) {
+      if (dynamic_cast<RTT::base::InputPortInterface *>(*port)) {
+        inputs[*port] = *it;
+      }
+    }
+  }
+
+  // Follow the connections of all output ports to these input ports
+  Dependencies derived;
+  for(std::list<SimClockActivity *>::const_iterator it = activities_.begin(); it != activities_.end(); ++it)
+  {
+    RTT::TaskContext *task = getTask(*it);
+    if (!task) {
+      continue;
+    }
+    RTT::DataFlowInterface::Ports ports = task->ports()->getPorts();
+    for(RTT::DataFlowInterface::Ports::const_iterator port = ports.begin(); port != ports.end(); ++port)
+    {
+      if (!dynamic_cast<RTT::base::OutputPortInterface *>(*port)) {
+        continue;
+      }
+
+      std::list<RTT::internal::ConnectionManager::ChannelDescriptor> channels = (*port)->getManager()->getChannels();
+      for(std::list<RTT::internal::ConnectionManager::ChannelDescriptor>::const_iterator channel = channels.begin(); channel != channels.end(); ++channel)
+      {
+        // Only connections within this process have a local connection ID
+        RTT::internal::LocalConnID *id = dynamic_cast<RTT::internal::LocalConnID *>(channel->get<0>().get());
+        if (!id) {
+          continue;
+        }
+        std::map<const RTT::base::PortInterface *, SimClockActivity *>::const_iterator input = inputs.find(id->ptr);
+        if (input != inputs.end() && input->second != *it) {
+          derived.insert(std::make_pair(*it, input->second));
+          RTT::log(RTT::Debug) << "Executing \"" << task->getName() << "\" before \"" << getTaskName(input->second)
+            << "\" in simulation, because of port \"" << (*port)->getName() << "\"." << RTT::endlog();
+        }
+      }
+    }
+  }
+
+  RTT::os::MutexLock lock(schedule_mutex_);
+  derived_dependencies_.swap(derived);
+}
+
+void SimClockActivityManager::setGroup(SimClockActivity *activity, const std::string &group)
+{
+  RTT::os::MutexLock lock(schedule_mutex_);
+  if (group.empty()) {
+    groups_.erase(activity);
+  } else {
+    groups_[activity] = group;
+  }
+  graph_dirty_ = true;
+}
+
+std::string SimClockActivityManager::getGroup(SimClockActivity *activity)
+{
+  RTT::os::MutexLock lock(schedule_mutex_);
+  std::map<SimClockActivity *, std::string>::const_iterator it = groups_.find(activity);
+  return (it != groups_.end()) ? it->second : std::string();
+}
+
 void SimClockActivityManager::add(SimClockActivity *activity)
 {
   RTT::os::MutexLock lock(modify_activities_mutex_);
   std::list<SimClockActivity *>::iterator it = std::find(activities_.begin(), activities_.end(), activity);
   if (it == activities_.end()) {
     activities_.push_back(activity);
+    RTT::os::MutexLock schedule_lock(schedule_mutex_);
+    graph_dirty_ = true;
   }
 }
 
@@ -120,4 +584,21 @@ void SimClockActivityManager::remove(SimClockActivity *activity)
   if (it != activities_.end()) {
     activities_.erase(it);
   }
+
+  RTT::os::MutexLock schedule_lock(schedule_mutex_);
+  groups_.erase(activity);
+
+  // Forget the dependencies of the activity
+  Dependencies *all[] = { &dependencies_, &derived_dependencies_ };
+  for(size_t i = 0; i < 2; i++) {
+    for(Dependencies::iterator dep = all[i]->begin(); dep != all[i]->end(); ) {
+      if (dep->first == activity || dep->second == activity) {
+        all[i]->erase(dep++);
+      } else {
+        ++dep;
+      }
+    }
+  }
+
+  graph_dirty_ = true;
 }
@@ -20,6 +20,15 @@ public:
 
     // TODO: load rosclock global service
     rtt_rosclock::set_sim_clock_activity(owner);
+
+    this->addOperation("setGroup", &SimClockActivityService::setGroup, this).doc(
+        "Put the SimClockActivity of this task into an ordering group. Tasks in the same group are executed in sequence.").arg(
+            "group","The name of the group, or an empty string to remove the task from its group.");
+  }
+
+  bool setGroup(const std::string &group)
+  {
+    return rtt_rosclock::set_sim_clock_group(this->getOwner(), group);
   }
 
 };
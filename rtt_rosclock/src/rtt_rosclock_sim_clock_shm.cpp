@@ -0,0 +1,163 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <rtt/Logger.hpp>
+
+#include <rtt_rosclock/rtt_rosclock_sim_clock_shm.h>
+
+using namespace rtt_rosclock;
+
+namespace {
+  //! Marks an initialized segment
+  const uint32_t SHM_MAGIC = 0x52434c4b;
+}
+
+SimClockShm::SimClockShm() :
+  owner_(false),
+  data_(NULL)
+{
+}
+
+SimClockShm::~SimClockShm()
+{
+  this->close();
+}
+
+bool SimClockShm::create(const std::string &name)
+{
+  return this->map(name, true);
+}
+
+bool SimClockShm::open(const std::string &name)
+{
+  return this->map(name, false);
+}
+
+bool SimClockShm::map(const std::string &name, bool create)
+{
+  this->close();
+
+  int fd = ::shm_open(name.c_str(), create ? (O_RDWR | O_CREAT) : O_RDWR, 0666);
+  if(fd < 0) {
+    RTT::log(RTT::Error) << "Could not open shared memory clock \"" << name << "\"." << RTT::endlog();
+    return false;
+  }
+
+  if(create && ::ftruncate(fd, sizeof(Data)) != 0) {
+    RTT::log(RTT::Error) << "Could not resize shared memory clock \"" << name << "\"." << RTT::endlog();
+    ::close(fd);
+    return false;
+  }
+
+  // Accessing the mapping beyond the end of a smaller segment would raise SIGBUS
+  struct stat status;
+  if(::fstat(fd, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(Data))) {
+    RTT::log(RTT::Error) << "Shared memory \"" << name << "\" is not a simulation clock." << RTT::endlog();
+    ::close(fd);
+    return false;
+  }
+
+  void *address = ::mmap(NULL, sizeof(Data), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(address == MAP_FAILED) {
+    RTT::log(RTT::Error) << "Could not map shared memory clock \"" << name << "\"." << RTT::endlog();
+    return false;
+  }
+
+  const Data *data = static_cast<const Data *>(address);
+  if(!create && data->magic == SHM_MAGIC && data->size != sizeof(Data)) {
+    RTT::log(RTT::Error) << "Shared memory clock \"" << name << "\" was created with another layout." << RTT::endlog();
+    ::munmap(address, sizeof(Data));
+    return false;
+  }
+
+  name_ = name;
+  owner_ = create;
+  data_ = static_cast<Data *>(address);
+
+  if(create) {
+    // A segment left behind by a crashed simulator is still marked as
+    // initialized, so readers have to stop using it while it is reset
+    data_->magic = 0;
+    __sync_synchronize();
+    data_->size = sizeof(Data);
+    data_->sequence = 0;
+    data_->sec = 0;
+    data_->nsec = 0;
+    data_->ticks = 0;
+    data_->acknowledged = 0;
+    __sync_synchronize();
+    data_->magic = SHM_MAGIC;
+  }
+
+  return true;
+}
+
+void SimClockShm::close()
+{
+  if(!data_) {
+    return;
+  }
+
+  ::munmap(data_, sizeof(Data));
+  if(owner_) {
+    ::shm_unlink(name_.c_str());
+  }
+
+  data_ = NULL;
+  owner_ = false;
+  name_.clear();
+}
+
+bool SimClockShm::isOpen() const
+{
+  return data_ != NULL;
+}
+
+void SimClockShm::write(const ros::Time &time)
+{
+  data_->sequence++;
+  __sync_synchronize();
+  data_->sec = time.sec;
+  data_->nsec = time.nsec;
+  data_->ticks++;
+  __sync_synchronize();
+  data_->sequence++;
+}
+
+bool SimClockShm::read(ros::Time &time, uint64_t &ticks) const
+{
+  if(data_->magic != SHM_MAGIC || data_->size != sizeof(Data)) {
+    return false;
+  }
+
+  const uint32_t sequence = data_->sequence;
+  if(sequence & 1) {
+    return false;
+  }
+  __sync_synchronize();
+
+  const uint32_t sec = data_->sec;
+  const uint32_t nsec = data_->nsec;
+  ticks = data_->ticks;
+
+  __sync_synchronize();
+  if(data_->sequence != sequence || ticks == 0) {
+    return false;
+  }
+
+  time = ros::Time(sec, nsec);
+  return true;
+}
+
+void SimClockShm::acknowledge(uint64_t ticks)
+{
+  data_->acknowledged = ticks;
+}
+
+uint64_t SimClockShm::acknowledged() const
+{
+  return data_->acknowledged;
+}
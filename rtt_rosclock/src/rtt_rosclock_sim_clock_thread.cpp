@@ -52,12 +52,23 @@
 #include <ros/node_handle.h>
 #include <ros/param.h>
 #include <ros/subscribe_options.h>
+#include <ros/transport_hints.h>
+
+#include <time.h>
 
 #include <rtt_rosclock/rtt_rosclock.h>
 
 using namespace rtt_rosclock;
 
 boost::shared_ptr<SimClockThread> SimClockThread::singleton;
+volatile bool SimClockThread::sim_time_enabled = false;
+
+namespace {
+  //! Length of the /clock subscriber queue, long enough that the thread sees every message it coalesces
+  const uint32_t CLOCK_QUEUE_SIZE = 100;
+  //! Time between two polls of the shared memory clock in nanoseconds
+  const long SHM_POLL_PERIOD = 10000;
+}
 
 boost::shared_ptr<SimClockThread> SimClockThread::GetInstance()
 {
@@ -90,6 +101,11 @@ SimClockThread::SimClockThread()
   , time_service_(RTT::os::TimeService::Instance())
   , clock_source_(SIM_CLOCK_SOURCE_MANUAL)
   , process_callbacks_(false)
+  , pending_(false)
+  , shm_ticks_(0)
+  , received_ticks_(0)
+  , coalesced_ticks_(0)
+  , dropped_ticks_(0)
 {
 }
 
@@ -122,15 +138,85 @@ bool SimClockThread::useManualClock()
   return this->setClockSource(SIM_CLOCK_SOURCE_MANUAL);
 }
 
+bool SimClockThread::useSharedMemoryClock(const std::string &name)
+{
+  if(!this->setClockSource(SIM_CLOCK_SOURCE_SHARED_MEMORY)) {
+    return false;
+  }
+
+  shm_name_ = name;
+
+  return true;
+}
+
 bool SimClockThread::simTimeEnabled() const
 {
   return this->isActive();
 }
 
+bool SimClockThread::SimTimeEnabled()
+{
+  return sim_time_enabled;
+}
+
+bool SimClockThread::setLockStepTopic(const std::string &topic)
+{
+  // Don't allow changing the topic while running
+  if(this->isActive()) {
+    RTT::log(RTT::Error) << "The SimClockThread lock-step topic cannot be changed while the thread is running." << RTT::endlog();
+    return false;
+  }
+
+  lock_step_topic_ = topic;
+
+  return true;
+}
+
+const std::string &SimClockThread::getLockStepTopic() const
+{
+  return lock_step_topic_;
+}
+
+unsigned long SimClockThread::getReceivedTicks() const
+{
+  return received_ticks_.read();
+}
+
+unsigned long SimClockThread::getCoalescedTicks() const
+{
+  return coalesced_ticks_.read();
+}
+
+unsigned long SimClockThread::getDroppedTicks() const
+{
+  return dropped_ticks_.read();
+}
+
+void SimClockThread::acknowledge(const ros::Time &time)
+{
+  if(clock_source_ == SIM_CLOCK_SOURCE_SHARED_MEMORY && shm_.isOpen()) {
+    shm_.acknowledge(shm_ticks_);
+  }
+
+  if(!lock_step_publisher_) {
+    return;
+  }
+
+  rosgraph_msgs::Clock ack;
+  ack.clock = time;
+  lock_step_publisher_.publish(ack);
+}
+
 void SimClockThread::clockMsgCallback(const rosgraph_msgs::ClockConstPtr& clock)
 {
-  // Update the RTT clock
-  updateClockInternal(ros::Time(clock->clock.sec, clock->clock.nsec));
+  // Only the latest of the messages which have arrived since the last update is processed
+  received_ticks_.inc();
+  if(pending_) {
+    coalesced_ticks_.inc();
+  }
+
+  pending_time_ = ros::Time(clock->clock.sec, clock->clock.nsec);
+  pending_ = true;
 }
 
 bool SimClockThread::updateClock(const ros::Time new_time)
@@ -189,6 +275,9 @@ bool SimClockThread::updateClockInternal(const ros::Time new_time)
     }
   }
 
+  // Tell the simulator that the update has been processed
+  this->acknowledge(new_time);
+
   return true;
 }
 
@@ -241,15 +330,36 @@ bool SimClockThread::initialize()
 
         // Subscribe the /clock topic (simulation time, e.g. published by Gazebo)
         ros::SubscribeOptions ops = ros::SubscribeOptions::create<rosgraph_msgs::Clock>(
-            "/clock", 1, boost::bind(&SimClockThread::clockMsgCallback, this, _1),
+            "/clock", CLOCK_QUEUE_SIZE, boost::bind(&SimClockThread::clockMsgCallback, this, _1),
             ros::VoidConstPtr(), &callback_queue_);
+        // Don't let Nagle's algorithm delay the small clock messages
+        ops.transport_hints = ros::TransportHints().tcpNoDelay();
         clock_subscriber_ = nh_.subscribe(ops);
+        pending_ = false;
 
         // The loop needs to run in order to call the callback queue
         process_callbacks_ = true;
       }
       break;
 
+    case SIM_CLOCK_SOURCE_SHARED_MEMORY:
+      {
+        RTT::log(RTT::Debug) << "[rtt_rosclock] Switching to simulated time based on shared memory clock " << shm_name_ << "..." << RTT::endlog();
+
+        if(!shm_.open(shm_name_)) {
+          process_callbacks_ = false;
+          return false;
+        }
+        shm_ticks_ = 0;
+
+        // Reset the timeservice and logger
+        this->resetTimeService();
+
+        // The loop needs to run in order to poll the shared memory
+        process_callbacks_ = true;
+      }
+      break;
+
     case SIM_CLOCK_SOURCE_MANUAL:
       {
         RTT::log(RTT::Debug) << "[rtt_rosclock] Switching to simulated time based on a manual clock source..." << RTT::endlog();
@@ -269,6 +379,17 @@ bool SimClockThread::initialize()
       }
   };
 
+  received_ticks_.set(0);
+  coalesced_ticks_.set(0);
+  dropped_ticks_.set(0);
+
+  if(!lock_step_topic_.empty()) {
+    RTT::log(RTT::Debug) << "[rtt_rosclock] Acknowledging simulation clock updates on " << lock_step_topic_ << "..." << RTT::endlog();
+    lock_step_publisher_ = nh_.advertise<rosgraph_msgs::Clock>(lock_step_topic_, 1);
+  }
+
+  sim_time_enabled = true;
+
   return true;
 }
 
@@ -276,9 +397,36 @@ void SimClockThread::loop()
 {
   static const ros::WallDuration timeout(0.1);
 
+  if(clock_source_ == SIM_CLOCK_SOURCE_SHARED_MEMORY) {
+    const timespec poll_period = { 0, SHM_POLL_PERIOD };
+
+    // Poll the shared memory clock
+    while(process_callbacks_) {
+      ros::Time time;
+      uint64_t ticks;
+      if(shm_.read(time, ticks) && ticks != shm_ticks_) {
+        received_ticks_.inc();
+        if(shm_ticks_ != 0 && ticks > shm_ticks_ + 1) {
+          dropped_ticks_.add(static_cast<int>(ticks - shm_ticks_ - 1));
+        }
+        shm_ticks_ = ticks;
+        updateClockInternal(time);
+      } else {
+        ::nanosleep(&poll_period, NULL);
+      }
+    }
+    return;
+  }
+
   // Service callbacks while
   while(process_callbacks_) {
     callback_queue_.callAvailable(timeout);
+
+    // Update the RTT clock
+    if(pending_) {
+      pending_ = false;
+      updateClockInternal(pending_time_);
+    }
   }
 }
 
@@ -292,8 +440,12 @@ void SimClockThread::finalize()
 {
   RTT::log(RTT::Info) << "Disabling simulated time..." << RTT::endlog();
 
+  sim_time_enabled = false;
+
   // Shutdown the subscriber so no more clock message events will be handled
   clock_subscriber_.shutdown();
+  lock_step_publisher_.shutdown();
+  shm_.close();
 
   // Shutdown the RTT Logger
   RTT::Logger::Instance()->shutdown();
@@ -33,6 +33,17 @@ macro(rtt_roscomm_debug)
   endif()
 endmacro()
 
+# Write a generated file only if its content changed, so that it is not rebuilt needlessly
+function(rtt_roscomm_write_if_changed file content)
+  if(EXISTS "${file}")
+    file(READ "${file}" _old_content)
+    if("${_old_content}" STREQUAL "${content}")
+      return()
+    endif()
+  endif()
+  file(WRITE "${file}" "${content}")
+endfunction()
+
 macro(ros_generate_rtt_typekit package)
   set(_package ${package})
   add_subdirectory(${rtt_roscomm_DIR}/../src/templates/typekit ${package}_typekit)
@@ -0,0 +1,106 @@
+#ifndef __RTT_ROSCOMM_RTT_ROSBAG_PLAYER_HPP
+#define __RTT_ROSCOMM_RTT_ROSBAG_PLAYER_HPP
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/OperationCaller.hpp>
+#include <rtt/base/OutputPortInterface.hpp>
+
+#include <ros/time.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include <rtt_roscomm/rtt_rosmsg_marshaller.hpp>
+
+namespace rtt_roscomm {
+
+  /** \brief Plays back topics of a bag file into RTT ports
+   *
+   * Each played topic gets an output port of the recorder with the ROS
+   * message type stored in the bag. Only the connections of the played
+   * topics are read from the bag, and their messages are deserialized with
+   * the ROS serialization marshaller of the generated typekits directly into
+   * the port samples.
+   *
+   * The messages with the same time stamp are written together, after which
+   * the simulation clock of rtt_rosclock is updated to that time stamp if
+   * \a sim_clock is set. The SimClockActivities are executed synchronously
+   * by the update, so components running in them step exactly at the recorded
+   * time stamps, after the data of that time stamp has been written.
+   *
+   * The bag is played back at \a rate times real time, or as fast as
+   * possible if \a rate is zero. The player should run in its own
+   * non-periodic activity.
+   */
+  class RosbagPlayer : public RTT::TaskContext
+  {
+  public:
+    RosbagPlayer(std::string const& name);
+    ~RosbagPlayer();
+
+    /** \brief Add an output port on which a topic is played back
+     *
+     * \param topic The topic in the bag
+     * \param port_name The name of the new output port
+     */
+    bool addTopic(const std::string &topic, const std::string &port_name);
+
+    //! Check if the whole bag has been played back
+    bool isFinished() const;
+
+    virtual bool configureHook();
+    virtual bool startHook();
+    virtual void updateHook();
+    virtual void stopHook();
+    virtual void cleanupHook();
+
+  protected:
+    //! A played topic
+    struct Playback
+    {
+      std::string topic;
+      std::string port_name;
+      boost::shared_ptr<RTT::base::OutputPortInterface> port;
+      RTT::base::DataSourceBase::shared_ptr sample;
+      RosMsgMarshallerBase *marshaller;
+      uint64_t messages;
+    };
+
+    //! Create the port of a played topic from its connection in the bag
+    bool createPort(Playback &playback, const rosbag::ConnectionInfo *connection);
+
+    //! Write a message from the bag to the port of its topic
+    void write(const rosbag::MessageInstance &message);
+
+    std::string prop_filename;
+    double prop_rate;
+    bool prop_sim_clock;
+
+    std::vector<boost::shared_ptr<Playback> > playbacks_;
+    std::map<std::string, Playback*> topics_;
+
+    rosbag::Bag bag_;
+    boost::shared_ptr<rosbag::View> view_;
+    rosbag::View::iterator next_;
+    bool finished_;
+
+    //! Serialization buffer, grown to the largest message
+    std::vector<uint8_t> buffer_;
+
+    //! Bag and wall time at which the playback started
+    ros::Time bag_start_;
+    ros::WallTime wall_start_;
+
+    RTT::OperationCaller<void(void)> use_manual_clock_;
+    RTT::OperationCaller<const bool(void)> enable_sim_clock_;
+    RTT::OperationCaller<void(const ros::Time)> update_sim_clock_;
+  };
+}
+
+#endif // ifndef __RTT_ROSCOMM_RTT_ROSBAG_PLAYER_HPP
@@ -0,0 +1,159 @@
+#ifndef __RTT_ROSCOMM_RTT_ROSBAG_RECORDER_HPP
+#define __RTT_ROSCOMM_RTT_ROSBAG_RECORDER_HPP
+
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/base/InputPortInterface.hpp>
+
+#include <rosbag/bag.h>
+#include <ros/message_traits.h>
+#include <ros/serialization.h>
+
+#include <rtt_roscomm/rtt_rosmsg_marshaller.hpp>
+
+namespace rtt_roscomm {
+
+  /** \brief A message which has already been serialized by a RosMsgMarshaller
+   *
+   * Writing it into a bag copies the serialized bytes once, without
+   * deserializing and serializing the message again.
+   */
+  struct SerializedMessage
+  {
+    const std::string *md5sum;
+    const std::string *datatype;
+    const std::string *definition;
+    const uint8_t *data;
+    uint32_t size;
+  };
+
+  /** \brief Records RTT ports with ROS message types into a bag file
+   *
+   * Each recorded topic gets an input port of the recorder, which is connected
+   * to the recorded output port through a lock-free buffer. Writing into it
+   * never blocks the (real-time) writer. The recorder drains the buffers in
+   * updateHook() and serializes the samples with the ROS serialization
+   * marshaller of the generated typekits directly into the bag, so the
+   * recorder should run in its own non-periodic, non-real-time activity.
+   *
+   * Messages are stamped with the ROS time at which they are taken out of the
+   * buffer. Bag chunks are compressed as set by the \a compression property,
+   * and the bag file is grown in preallocated extents of \a preallocation
+   * bytes, so that the file system does not have to allocate blocks for every
+   * chunk.
+   */
+  class RosbagRecorder : public RTT::TaskContext
+  {
+  public:
+    RosbagRecorder(std::string const& name);
+    ~RosbagRecorder();
+
+    /** \brief Record a port of a peer component
+     *
+     * \param port_name The port to record, like "peer.port"
+     * \param topic The topic under which the samples are stored in the bag
+     */
+    bool record(const std::string &port_name, const std::string &topic);
+
+    /** \brief Add an input port which is recorded
+     *
+     * The port has to be connected by the caller, preferably with a
+     * lock-free buffered connection.
+     *
+     * \param port_name The name of the new input port
+     * \param type_name The ROS message type, like "std_msgs/Header"
+     * \param topic The topic under which the samples are stored in the bag
+     */
+    bool addTopic(const std::string &port_name, const std::string &type_name, const std::string &topic);
+
+    virtual bool configureHook();
+    virtual bool startHook();
+    virtual void updateHook();
+    virtual void stopHook();
+
+  protected:
+    //! A recorded port
+    struct Recording
+    {
+      std::string topic;
+      boost::shared_ptr<RTT::base::InputPortInterface> port;
+      RTT::base::DataSourceBase::shared_ptr sample;
+      RosMsgMarshallerBase *marshaller;
+      //! Serialization buffer, grown to the largest sample
+      std::vector<uint8_t> buffer;
+      //! Description of the message type in the bag
+      std::string md5sum;
+      std::string datatype;
+      std::string definition;
+      uint64_t messages;
+      uint64_t bytes;
+    };
+
+    Recording *addRecording(const std::string &port_name, const RTT::types::TypeInfo *ti, const std::string &topic);
+
+    //! Write all buffered samples of a recording into the bag
+    void drain(Recording &recording);
+
+    //! Allocate the file extent up to \a size bytes
+    void preallocate(uint64_t size);
+
+    std::string prop_filename;
+    std::string prop_compression;
+    int prop_chunk_threshold;
+    int prop_buffer_size;
+    unsigned int prop_preallocation;
+
+    std::vector<boost::shared_ptr<Recording> > recordings_;
+    rosbag::Bag bag_;
+
+    //! File descriptor used to allocate the extents of the bag file
+    int fd_;
+    //! End of the allocated extents of the bag file
+    uint64_t allocated_;
+  };
+}
+
+namespace ros {
+  namespace message_traits {
+    template<> struct IsMessage<rtt_roscomm::SerializedMessage> : TrueType { };
+
+    template<> struct MD5Sum<rtt_roscomm::SerializedMessage>
+    {
+      static const char* value(const rtt_roscomm::SerializedMessage &m) { return m.md5sum->c_str(); }
+      static const char* value() { return "*"; }
+    };
+
+    template<> struct DataType<rtt_roscomm::SerializedMessage>
+    {
+      static const char* value(const rtt_roscomm::SerializedMessage &m) { return m.datatype->c_str(); }
+      static const char* value() { return "*"; }
+    };
+
+    template<> struct Definition<rtt_roscomm::SerializedMessage>
+    {
+      static const char* value(const rtt_roscomm::SerializedMessage &m) { return m.definition->c_str(); }
+    };
+  }
+
+  namespace serialization {
+    template<> struct Serializer<rtt_roscomm::SerializedMessage>
+    {
+      template<typename Stream>
+      inline static void write(Stream &stream, const rtt_roscomm::SerializedMessage &m) {
+        std::memcpy(stream.advance(m.size), m.data, m.size);
+      }
+
+      inline static uint32_t serializedLength(const rtt_roscomm::SerializedMessage &m) {
+        return m.size;
+      }
+    };
+  }
+}
+
+#endif // ifndef __RTT_ROSCOMM_RTT_ROSBAG_RECORDER_HPP
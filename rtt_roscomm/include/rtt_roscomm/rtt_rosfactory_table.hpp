@@ -0,0 +1,33 @@
+#ifndef __RTT_ROSCOMM_RTT_ROSFACTORY_TABLE_HPP
+#define __RTT_ROSCOMM_RTT_ROSFACTORY_TABLE_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace rtt_roscomm {
+
+  //! Orders factory table entries by their type name
+  struct FactoryNameLess
+  {
+    template<class Factory>
+    bool operator()(const Factory &factory, const char *name) const {
+      return std::strcmp(factory.name, name) < 0;
+    }
+  };
+
+  /** \brief Find the entry for a type in a factory table
+   *
+   * The tables in generated typekits and transport plugins are sorted by type
+   * name, so the entry is found with a binary search. Returns NULL if the
+   * table has no entry for the type.
+   */
+  template<class Factory>
+  const Factory *findFactory(const Factory *begin, const Factory *end, const std::string &name)
+  {
+    const Factory *factory = std::lower_bound(begin, end, name.c_str(), FactoryNameLess());
+    return (factory != end && name == factory->name) ? factory : NULL;
+  }
+}
+
+#endif // ifndef __RTT_ROSCOMM_RTT_ROSFACTORY_TABLE_HPP
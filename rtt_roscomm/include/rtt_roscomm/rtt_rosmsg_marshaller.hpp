@@ -0,0 +1,149 @@
+#ifndef __RTT_ROSCOMM_RTT_ROSMSG_MARSHALLER_HPP
+#define __RTT_ROSCOMM_RTT_ROSMSG_MARSHALLER_HPP
+
+#include <string>
+#include <utility>
+
+#include <ros/message_traits.h>
+#include <ros/serialization.h>
+
+#include <rtt/types/TypeInfo.hpp>
+#include <rtt/types/TypeMarshaller.hpp>
+#include <rtt/internal/DataSource.hpp>
+
+//! Protocol ID of the binary ros::serialization marshaller of ROS message types
+#define ORO_ROS_SERIALIZATION_PROTOCOL_ID 4
+
+namespace rtt_roscomm {
+
+  //! ROS serialization protocol ID
+  static const int serialization_protocol_id = ORO_ROS_SERIALIZATION_PROTOCOL_ID;
+
+  /** \brief Binary marshaller for ROS message types
+   *
+   * Samples are marshalled with ros::serialization, in the same format in
+   * which they are sent over ROS topics and stored in bag files. Unlike the
+   * StructTypeInfo decomposition into PropertyBags, this needs one pass over
+   * the message. It is registered for all types of generated typekits under
+   * ORO_ROS_SERIALIZATION_PROTOCOL_ID.
+   */
+  class RosMsgMarshallerBase : public RTT::types::TypeMarshaller
+  {
+  public:
+    //! Get the ROS data type, like "std_msgs/Header"
+    virtual std::string getDataType() const = 0;
+    //! Get the MD5 sum of the ROS message definition
+    virtual std::string getMD5Sum() const = 0;
+    //! Get the full ROS message definition
+    virtual std::string getMessageDefinition() const = 0;
+
+    //! This marshaller does not provide a stream transport
+    virtual RTT::base::ChannelElementBase::shared_ptr createStream(
+        RTT::base::PortInterface *port,
+        const RTT::ConnPolicy &policy,
+        bool is_sender) const
+    {
+      return RTT::base::ChannelElementBase::shared_ptr();
+    }
+
+    //! No per-connection state is needed
+    virtual void* createCookie() const { return NULL; }
+    virtual void deleteCookie(void *cookie) const { }
+  };
+
+  template<class T>
+  class RosMsgMarshaller : public RosMsgMarshallerBase
+  {
+  public:
+    virtual std::string getDataType() const {
+      return ros::message_traits::datatype<T>();
+    }
+
+    virtual std::string getMD5Sum() const {
+      return ros::message_traits::md5sum<T>();
+    }
+
+    virtual std::string getMessageDefinition() const {
+      return ros::message_traits::definition<T>();
+    }
+
+    /** \brief Serialize the sample of \a source into \a blob
+     *
+     * Returns the blob and the serialized size, or (NULL, -1) if the sample
+     * does not fit into \a size bytes.
+     */
+    virtual std::pair<void const*, int> fillBlob(
+        RTT::base::DataSourceBase::shared_ptr source,
+        void *blob,
+        int size,
+        void *cookie) const
+    {
+      typename RTT::internal::DataSource<T>::shared_ptr data =
+        RTT::internal::DataSource<T>::narrow(source.get());
+      if(!data) {
+        return std::make_pair(static_cast<void const*>(NULL), -1);
+      }
+
+      // Evaluate the data source once
+      data->evaluate();
+      const T &msg = data->rvalue();
+      const uint32_t length = ros::serialization::serializationLength(msg);
+      if(size < 0 || length > static_cast<uint32_t>(size)) {
+        return std::make_pair(static_cast<void const*>(NULL), -1);
+      }
+
+      ros::serialization::OStream stream(static_cast<uint8_t*>(blob), length);
+      ros::serialization::serialize(stream, msg);
+      return std::make_pair(static_cast<void const*>(blob), static_cast<int>(length));
+    }
+
+    //! Deserialize \a blob into the sample of \a target
+    virtual bool updateFromBlob(
+        const void *blob,
+        int size,
+        RTT::base::DataSourceBase::shared_ptr target,
+        void *cookie) const
+    {
+      typename RTT::internal::AssignableDataSource<T>::shared_ptr data =
+        RTT::internal::AssignableDataSource<T>::narrow(target.get());
+      if(!data || size < 0) {
+        return false;
+      }
+
+      try {
+        ros::serialization::IStream stream(const_cast<uint8_t*>(static_cast<const uint8_t*>(blob)), size);
+        ros::serialization::deserialize(stream, data->set());
+      } catch(ros::serialization::StreamOverrunException &) {
+        return false;
+      }
+
+      data->updated();
+      return true;
+    }
+
+    //! Get the serialized size of the sample of \a sample
+    virtual unsigned int getSampleSize(
+        RTT::base::DataSourceBase::shared_ptr sample,
+        void *cookie = NULL) const
+    {
+      typename RTT::internal::DataSource<T>::shared_ptr data =
+        RTT::internal::DataSource<T>::narrow(sample.get());
+      if(!data) {
+        return 0;
+      }
+      data->evaluate();
+      return ros::serialization::serializationLength(data->rvalue());
+    }
+  };
+
+  //! Get the ROS serialization marshaller of a type, or NULL if it has none
+  inline RosMsgMarshallerBase *getRosMsgMarshaller(RTT::types::TypeInfo *ti)
+  {
+    if(ti == NULL) {
+      return NULL;
+    }
+    return dynamic_cast<RosMsgMarshallerBase*>(ti->getProtocol(ORO_ROS_SERIALIZATION_PROTOCOL_ID));
+  }
+}
+
+#endif // ifndef __RTT_ROSCOMM_RTT_ROSMSG_MARSHALLER_HPP
@@ -0,0 +1,69 @@
+#ifndef __RTT_ROSCOMM_RTT_ROSSERVICE_MESSAGE_POOL_H
+#define __RTT_ROSCOMM_RTT_ROSSERVICE_MESSAGE_POOL_H
+
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+#include <rtt/internal/TsPool.hpp>
+#include <rtt/os/oro_allocator.hpp>
+
+/** \brief Lock-free pool of ROS service request or response objects
+ *
+ * roscpp normally allocates a new request and response object for every
+ * incoming service call. A ROSServiceMessagePool hands out recycled objects
+ * instead, so that variable-length fields keep the capacity they grew to in
+ * earlier calls. The shared pointers returned by allocate() allocate their
+ * reference counts with the RTT real-time allocator. If the pool is
+ * exhausted, objects are allocated on the heap.
+ */
+template<class T>
+class ROSServiceMessagePool
+{
+public:
+  typedef boost::shared_ptr<ROSServiceMessagePool<T> > shared_ptr;
+
+  /** \brief Construct a pool with \a size preallocated objects
+   *
+   * If \a reset is true, objects are re-initialized to their default value
+   * when they are taken from the pool. They are copy-assigned from a default
+   * object, which empties the vector and string fields but keeps their
+   * capacity. Messages nested in array fields are destroyed, though.
+   */
+  ROSServiceMessagePool(unsigned int size, bool reset) :
+    pool_(size),
+    reset_(reset),
+    empty_()
+  { }
+
+  //! Get an object from \a pool, or from the heap if the pool is exhausted
+  static boost::shared_ptr<T> allocate(const shared_ptr &pool) {
+    T *obj = pool->pool_.allocate();
+    if(obj == NULL) {
+      return boost::make_shared<T>();
+    }
+    if(pool->reset_) {
+      // Assign from an lvalue, since moving a temporary would release the buffers
+      *obj = pool->empty_;
+    }
+    return boost::shared_ptr<T>(obj, Releaser(pool), RTT::os::rt_allocator<T>());
+  }
+
+private:
+  //! Deleter which returns an object to the pool it came from
+  struct Releaser
+  {
+    Releaser(const shared_ptr &pool) : pool_(pool) { }
+    void operator()(T *obj) { pool_->pool_.deallocate(obj); }
+    shared_ptr pool_;
+  };
+  friend struct Releaser;
+
+  //! The preallocated objects
+  RTT::internal::TsPool<T> pool_;
+  //! Re-initialize objects when they are taken from the pool
+  bool reset_;
+  //! The default value of reset objects
+  const T empty_;
+};
+
+#endif // ifndef __RTT_ROSCOMM_RTT_ROSSERVICE_MESSAGE_POOL_H
@@ -2,17 +2,43 @@
 #define __RTT_ROSCOMM_RTT_ROSSERVICE_PROXY_H
 
 #include <ros/ros.h>
+#include <ros/service_callback_helper.h>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
 
 #include <rtt/RTT.hpp>
 #include <rtt/plugin/ServicePlugin.hpp>
 
+#include <rtt_roscomm/rtt_rosservice_message_pool.h>
+#include <rtt_roscomm/rtt_rosservice_statistics.h>
+
 //! Abstract ROS Service Proxy
 class ROSServiceProxyBase
 {
 public:
   ROSServiceProxyBase(const std::string &service_name) : service_name_(service_name) { }
+  virtual ~ROSServiceProxyBase() { }
   //! Get the name of the ROS service
   const std::string& getServiceName() const { return service_name_; }
+
+  //! Get a copy of the call statistics of this proxy
+  ROSServiceProxyStatistics getStatistics() {
+    RTT::os::MutexLock lock(statistics_mutex_);
+    return statistics_;
+  }
+
+  //! Reset the call statistics of this proxy
+  void resetStatistics() {
+    RTT::os::MutexLock lock(statistics_mutex_);
+    statistics_ = ROSServiceProxyStatistics();
+  }
+
+protected:
+  //! Call statistics, guarded by statistics_mutex_
+  ROSServiceProxyStatistics statistics_;
+  RTT::os::Mutex statistics_mutex_;
+
 private:
   //! ROS Service name (fully qualified)
   std::string service_name_;
@@ -25,57 +51,146 @@ class ROSServiceServerProxyBase : public ROSServiceProxyBase
 public:
   ROSServiceServerProxyBase(const std::string &service_name) :
     ROSServiceProxyBase(service_name),
-    proxy_operation_caller_()
+    proxy_operation_caller_(),
+    engine_(NULL),
+    tracing_(0),
+    call_seq_(0),
+    engine_marker_(new ROSServiceEngineMarker())
   { }
+
+  virtual ~ROSServiceServerProxyBase() {
+    // Stop serving calls before the marker is released, which the engine may still have queued
+    server_.shutdown();
+    engine_marker_->release();
+  }
   
   //! Connect an RTT Operation to this ROS service server
   bool connect(RTT::TaskContext *owner, RTT::OperationInterfacePart* operation) {
+    engine_ = owner->engine();
     // Link the caller with the operation
     return proxy_operation_caller_->setImplementation(
         operation->getLocalOperation(),
         owner->engine());
   }
 
+  /** \brief Measure how long calls wait for the owner's ExecutionEngine
+   *
+   * When enabled, a marker message is queued in the owner's engine ahead of
+   * each operation call, which splits the time spent in the operation call
+   * into waiting and executing. Note that the marker triggers the owner's
+   * activity, like the operation call itself does.
+   */
+  void setTracing(bool tracing) { tracing_.set(tracing ? 1 : 0); }
+
 protected:
+  //! Call the operation and record the timing of the call
+  template<class Call>
+  bool tracedCall(Call call) {
+    // Calls come from concurrent spinner threads, so each one takes a unique sequence number
+    int seq;
+    do {
+      seq = call_seq_.read() + 1;
+    } while(!call_seq_.cmpxchg(seq - 1, seq));
+
+    // Time with the wall clock, since the RTT clock may be driven by a simulation
+    const RTT::nsecs start = ros::WallTime::now().toNSec();
+    const bool traced = tracing_.read() != 0 && engine_marker_->enqueue(engine_, seq);
+
+    const bool success = call();
+
+    const RTT::nsecs end = ros::WallTime::now().toNSec();
+    RTT::nsecs executed = start;
+    if(!traced || !engine_marker_->executed(seq, executed) || executed > end) {
+      executed = start;
+    }
+
+    RTT::os::MutexLock lock(statistics_mutex_);
+    statistics_.calls++;
+    if(!success) { statistics_.errors++; }
+    if(traced) { statistics_.wait.add(RTT::nsecs_to_Seconds(executed - start)); }
+    statistics_.execute.add(RTT::nsecs_to_Seconds(end - executed));
+
+    return success;
+  }
+
   //! The underlying ROS service server
   ros::ServiceServer server_;
   //! The underlying RTT operation caller
   boost::shared_ptr<RTT::base::OperationCallerBaseInvoker> proxy_operation_caller_;
+  //! The engine of the owner of the operation
+  RTT::ExecutionEngine *engine_;
+  //! Non-zero to trace the time calls wait for the owner's engine
+  RTT::os::AtomicInt tracing_;
+  //! Sequence number of the last call
+  RTT::os::AtomicInt call_seq_;
+  //! Marker used to trace the time calls wait for the owner's engine, see ROSServiceEngineMarker::release()
+  ROSServiceEngineMarker *engine_marker_;
 };
 
 template<class ROS_SERVICE_T>
 class ROSServiceServerProxy : public ROSServiceServerProxyBase 
 {
 public:
+  typedef typename ROS_SERVICE_T::Request RequestType;
+  typedef typename ROS_SERVICE_T::Response ResponseType;
+
   //! Operation caller for a ROS service server proxy
-  typedef RTT::OperationCaller<bool(typename ROS_SERVICE_T::Request&, typename ROS_SERVICE_T::Response&)> ProxyOperationCallerType;
+  typedef RTT::OperationCaller<bool(RequestType&, ResponseType&)> ProxyOperationCallerType;
+
+  //! Default number of pooled request and response objects
+  static const unsigned int DEFAULT_POOL_SIZE = 8;
 
   /** \brief Construct a ROS service server and associate it with an Orocos
    * task's required interface and operation caller.
+   *
+   * Requests and responses are taken from pools of \a pool_size
+   * preallocated objects instead of being allocated by roscpp for each call.
    */
-  ROSServiceServerProxy(const std::string &service_name) :
-    ROSServiceServerProxyBase(service_name)
+  ROSServiceServerProxy(const std::string &service_name, unsigned int pool_size = DEFAULT_POOL_SIZE) :
+    ROSServiceServerProxyBase(service_name),
+    typed_proxy_operation_caller_(new ProxyOperationCallerType("ROS_SERVICE_SERVER_PROXY")),
+    request_pool_(new ROSServiceMessagePool<RequestType>(pool_size, false)),
+    response_pool_(new ROSServiceMessagePool<ResponseType>(pool_size, true))
   {
-    // Construct operation caller
-    proxy_operation_caller_.reset(new ProxyOperationCallerType("ROS_SERVICE_SERVER_PROXY"));
+    // Share the concretely-typed operation caller with the base class
+    proxy_operation_caller_ = typed_proxy_operation_caller_;
+
+    // Construct the ROS service server with pooled requests and responses
+    ros::AdvertiseServiceOptions ops;
+    ops.service = service_name;
+    ops.md5sum = ros::service_traits::md5sum<RequestType>();
+    ops.datatype = ros::service_traits::datatype<RequestType>();
+    ops.req_datatype = ros::message_traits::datatype<RequestType>();
+    ops.res_datatype = ros::message_traits::datatype<ResponseType>();
+    ops.helper = boost::make_shared<ros::ServiceCallbackHelperT<ros::ServiceSpec<RequestType, ResponseType> > >(
+        boost::bind(&ROSServiceServerProxy<ROS_SERVICE_T>::ros_service_callback, this, _1, _2),
+        boost::bind(&ROSServiceMessagePool<RequestType>::allocate, request_pool_),
+        boost::bind(&ROSServiceMessagePool<ResponseType>::allocate, response_pool_));
 
-    // Construct the ROS service server
     ros::NodeHandle nh;
-    server_ = nh.advertiseService(
-        service_name, 
-        &ROSServiceServerProxy<ROS_SERVICE_T>::ros_service_callback, 
-        this);
+    server_ = nh.advertiseService(ops);
   }
 
 private:
   
   //! The callback called by the ROS service server when this service is invoked
-  bool ros_service_callback(typename ROS_SERVICE_T::Request& request, typename ROS_SERVICE_T::Response& response) {
-    // Downcast the proxy operation caller
-    ProxyOperationCallerType &proxy_operation_caller = *dynamic_cast<ProxyOperationCallerType*>(proxy_operation_caller_.get());
+  bool ros_service_callback(RequestType& request, ResponseType& response) {
+    return this->tracedCall(boost::bind(&ROSServiceServerProxy<ROS_SERVICE_T>::call_operation, this, boost::ref(request), boost::ref(response)));
+  }
+
+  //! Call the RTT operation
+  bool call_operation(RequestType& request, ResponseType& response) {
     // Check if the operation caller is ready, and then call it
-    return proxy_operation_caller_->ready() && proxy_operation_caller(request, response);
+    ProxyOperationCallerType &proxy_operation_caller = *typed_proxy_operation_caller_;
+    return proxy_operation_caller.ready() && proxy_operation_caller(request, response);
   }
+
+  //! The underlying RTT operation caller with its concrete type
+  boost::shared_ptr<ProxyOperationCallerType> typed_proxy_operation_caller_;
+  //! Recycled request objects
+  typename ROSServiceMessagePool<RequestType>::shared_ptr request_pool_;
+  //! Recycled response objects
+  typename ROSServiceMessagePool<ResponseType>::shared_ptr response_pool_;
 };
 
 
@@ -114,26 +229,39 @@ public:
   ROSServiceClientProxy(const std::string &service_name) :
     ROSServiceClientProxyBase(service_name)
   {
-    // Construct a new 
-    proxy_operation_.reset(new ProxyOperationType("ROS_SERVICE_CLIENT_PROXY"));
+    // Construct a new operation
+    boost::shared_ptr<ProxyOperationType> proxy_operation(new ProxyOperationType("ROS_SERVICE_CLIENT_PROXY"));
 
     // Construct the underlying service client
     ros::NodeHandle nh;
     client_ = nh.serviceClient<ROS_SERVICE_T>(service_name);
 
     // Link the operation with the service client
-    dynamic_cast<ProxyOperationType*>(proxy_operation_.get())->calls(
+    proxy_operation->calls(
         &ROSServiceClientProxy<ROS_SERVICE_T>::orocos_operation_callback,
         this,
         RTT::ClientThread);
+
+    proxy_operation_ = proxy_operation;
   }
 
 private:
   
   //! The callback for the RTT operation
   bool orocos_operation_callback(typename ROS_SERVICE_T::Request& request, typename ROS_SERVICE_T::Response& response) {
+    // Time with the wall clock, since the RTT clock may be driven by a simulation
+    const RTT::nsecs start = ros::WallTime::now().toNSec();
+
     // Make sure the ROS service client exists and then call it (blocking)
-    return client_.exists() && client_.isValid() && client_.call(request, response);
+    const bool success = client_.exists() && client_.isValid() && client_.call(request, response);
+
+    const RTT::nsecs end = ros::WallTime::now().toNSec();
+    RTT::os::MutexLock lock(statistics_mutex_);
+    statistics_.calls++;
+    if(!success) { statistics_.errors++; }
+    statistics_.network.add(RTT::nsecs_to_Seconds(end - start));
+
+    return success;
   }
 };
 
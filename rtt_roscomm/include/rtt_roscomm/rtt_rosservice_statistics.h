@@ -0,0 +1,131 @@
+#ifndef __RTT_ROSCOMM_RTT_ROSSERVICE_STATISTICS_H
+#define __RTT_ROSCOMM_RTT_ROSSERVICE_STATISTICS_H
+
+#include <algorithm>
+
+#include <ros/time.h>
+
+#include <rtt/Time.hpp>
+#include <rtt/os/Atomic.hpp>
+#include <rtt/base/DisposableInterface.hpp>
+#include <rtt/ExecutionEngine.hpp>
+
+//! Timing statistics of one phase of proxied ROS service calls
+struct ROSServiceTiming
+{
+  ROSServiceTiming() : count(0), last(0.0), min(0.0), max(0.0), total(0.0) { }
+
+  //! Add the duration of one call
+  void add(RTT::Seconds dt) {
+    min = (count == 0) ? dt : std::min(min, dt);
+    max = (count == 0) ? dt : std::max(max, dt);
+    last = dt;
+    total += dt;
+    ++count;
+  }
+
+  //! Get the mean duration of all calls
+  RTT::Seconds mean() const { return (count > 0) ? total / count : 0.0; }
+
+  unsigned long count;
+  RTT::Seconds last;
+  RTT::Seconds min;
+  RTT::Seconds max;
+  RTT::Seconds total;
+};
+
+//! Call counts and per-phase timings of a ROS service proxy
+struct ROSServiceProxyStatistics
+{
+  ROSServiceProxyStatistics() : calls(0), errors(0) { }
+
+  //! Number of calls through the proxy
+  unsigned long calls;
+  //! Number of calls which returned false
+  unsigned long errors;
+  //! Time spent in the ROS service client call (client proxies only)
+  ROSServiceTiming network;
+  //! Time spent waiting for the owner's ExecutionEngine (server proxies only, when tracing)
+  ROSServiceTiming wait;
+  //! Time spent executing the RTT operation (server proxies only)
+  ROSServiceTiming execute;
+};
+
+/** \brief Message which timestamps when an ExecutionEngine processes it
+ *
+ * A server proxy queues this marker in the owner's ExecutionEngine right
+ * before calling the operation. Since the engine processes its messages in
+ * order, the time at which the marker is executed is the time at which the
+ * engine started to process the operation call. Only one call can be traced
+ * at a time, since the marker is reused.
+ *
+ * The marker is allocated on the heap and destroyed with release(), so that
+ * a marker which is still queued when its proxy is destroyed is deleted by
+ * the engine once it has been processed.
+ */
+class ROSServiceEngineMarker : public RTT::base::DisposableInterface
+{
+public:
+  ROSServiceEngineMarker() :
+    state_(IDLE),
+    executed_seq_(0),
+    seq_(0),
+    executed_nsecs_(0)
+  { }
+
+  //! Queue the marker for call \a seq, unless it is still queued from an earlier call
+  bool enqueue(RTT::ExecutionEngine *engine, int seq) {
+    if(engine == NULL || !state_.cmpxchg(IDLE, QUEUED)) {
+      return false;
+    }
+    seq_ = seq;
+    if(!engine->process(this)) {
+      state_.set(IDLE);
+      return false;
+    }
+    return true;
+  }
+
+  //! Get the wall time at which the marker queued for call \a seq was processed
+  bool executed(int seq, RTT::nsecs &nsecs) const {
+    if(executed_seq_.read() != seq) {
+      return false;
+    }
+    nsecs = executed_nsecs_;
+    return true;
+  }
+
+  //! Delete the marker now, or once the engine has processed it if it is queued
+  void release() {
+    if(!state_.cmpxchg(QUEUED, RELEASED)) {
+      delete this;
+    }
+  }
+
+  virtual void executeAndDispose() {
+    executed_nsecs_ = ros::WallTime::now().toNSec();
+    executed_seq_.set(seq_);
+    this->dispose();
+  }
+
+  virtual void dispose() {
+    if(!state_.cmpxchg(QUEUED, IDLE)) {
+      // The proxy has been destroyed while the marker was queued
+      delete this;
+    }
+  }
+
+private:
+  enum State { IDLE, QUEUED, RELEASED };
+
+  //! Whether the marker is queued in an engine, and whether its proxy still exists
+  RTT::os::AtomicInt state_;
+  //! The call for which the marker has last been processed
+  RTT::os::AtomicInt executed_seq_;
+  //! The call for which the marker is queued
+  int seq_;
+  //! The wall time at which the marker has last been processed
+  RTT::nsecs executed_nsecs_;
+};
+
+#endif // ifndef __RTT_ROSCOMM_RTT_ROSSERVICE_STATISTICS_H
@@ -0,0 +1,65 @@
+#ifndef __RTT_ROSCOMM_RTT_ROSTRANSPORT_REGISTRY_HPP
+#define __RTT_ROSCOMM_RTT_ROSTRANSPORT_REGISTRY_HPP
+
+#include <string>
+
+#include <rtt/types/TypeInfo.hpp>
+#include <rtt/types/TypeTransporter.hpp>
+
+#include <rtt_roscomm/rtt_rostopic.h>
+#include <rtt_roscomm/rtt_rostopic_ros_msg_transporter.hpp>
+#include <rtt_roscomm/rtt_rosmsg_marshaller.hpp>
+#include <rtt_roscomm/rtt_rosfactory_table.hpp>
+
+namespace rtt_roscomm {
+
+  /** \brief Factory for the ROS transport and marshaller of one ROS message type
+   *
+   * Generated transport plugins contain a constant table of these, sorted by
+   * name, which they search when RTT asks them to add their transport to a
+   * type.
+   */
+  struct TransportFactory
+  {
+    //! The RTT type name of the message, like "/std_msgs/Header"
+    const char *name;
+    //! Creates the transporter for the message
+    RTT::types::TypeTransporter *(*create)();
+    //! Creates the binary marshaller for the message
+    RTT::types::TypeTransporter *(*create_marshaller)();
+  };
+
+  //! Create the ROS transporter for message type \a T
+  template<class T>
+  RTT::types::TypeTransporter *createRosMsgTransporter()
+  {
+    return new RosMsgTransporter<T>();
+  }
+
+  //! Create the ROS serialization marshaller for message type \a T
+  template<class T>
+  RTT::types::TypeTransporter *createRosMsgMarshaller()
+  {
+    return new RosMsgMarshaller<T>();
+  }
+
+  /** \brief Add the ROS transport and marshaller to a type from a transport plugin's factory table
+   *
+   * Returns false if the table has no factory for the type.
+   */
+  inline bool registerTransportFromFactories(
+      const TransportFactory *begin,
+      const TransportFactory *end,
+      const std::string &name,
+      RTT::types::TypeInfo *ti)
+  {
+    const TransportFactory *factory = findFactory(begin, end, name);
+    if(factory == NULL) {
+      return false;
+    }
+    ti->addProtocol(ORO_ROS_SERIALIZATION_PROTOCOL_ID, factory->create_marshaller());
+    return ti->addProtocol(ORO_ROS_PROTOCOL_ID, factory->create());
+  }
+}
+
+#endif // ifndef __RTT_ROSCOMM_RTT_ROSTRANSPORT_REGISTRY_HPP
@@ -0,0 +1,161 @@
+#ifndef __RTT_ROSCOMM_RTT_ROSTYPEKIT_LOADER_HPP
+#define __RTT_ROSCOMM_RTT_ROSTYPEKIT_LOADER_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include <rtt/Service.hpp>
+#include <rtt/OperationCaller.hpp>
+#include <rtt/Logger.hpp>
+#include <rtt/types/Types.hpp>
+#include <rtt/types/TypeInfoRepository.hpp>
+#include <rtt/internal/GlobalService.hpp>
+
+#include <rtt_roscomm/rtt_rosfactory_table.hpp>
+
+namespace rtt_roscomm {
+
+  /** \brief Factory for the RTT types of one ROS message type
+   *
+   * Generated typekits contain a constant table of these, sorted by name,
+   * which they use to load all of their types at once, or, in lazy mode, one
+   * at a time on demand.
+   */
+  struct TypekitFactory
+  {
+    //! The RTT type name of the message, like "/std_msgs/Header"
+    const char *name;
+    //! Adds the TypeInfo for the message and its sequence types
+    void (*add_type)();
+    //! Returns the full ROS message definition
+    const char *(*definition)();
+  };
+
+  /** \brief Check if generated typekits should register their types lazily
+   *
+   * Lazy loading is enabled by setting the RTT_ROSCOMM_LAZY_TYPEKITS
+   * environment variable to a non-zero value before importing typekits.
+   */
+  inline bool lazyTypekitsEnabled()
+  {
+    const char *lazy = std::getenv("RTT_ROSCOMM_LAZY_TYPEKITS");
+    return lazy != NULL && std::strlen(lazy) > 0 && std::strcmp(lazy, "0") != 0;
+  }
+
+  /** \brief Get the global service in which lazily-loaded typekits register
+   *
+   * Each typekit adds an operation named after its ROS package which loads
+   * one of its types by name.
+   */
+  inline RTT::Service::shared_ptr lazyTypekitService()
+  {
+    return RTT::internal::GlobalService::Instance()->provides("ros")->provides("lazy_typekits");
+  }
+
+  /** \brief Load a ROS message type and the message types it depends on
+   *
+   * The type is given by its RTT type name (like "/std_msgs/Header"), or
+   * its ROS type name (like "std_msgs/Header"). If the type has already been
+   * loaded, this does nothing.
+   */
+  inline bool loadType(const std::string &type_name)
+  {
+    std::string name = type_name;
+    if(name.empty()) {
+      return false;
+    }
+    if(name[0] != '/') {
+      name = "/" + name;
+    }
+
+    // Check if the type has been loaded already
+    if(RTT::types::Types()->type(name) != NULL) {
+      return true;
+    }
+
+    // Strip sequence suffixes and the "c" prefix of fixed-size arrays
+    std::string::size_type separator = name.find('/', 1);
+    if(separator == std::string::npos) {
+      RTT::log(RTT::Error) << "Invalid ROS message type name \"" << type_name << "\"." << RTT::endlog();
+      return false;
+    }
+    std::string package = name.substr(1, separator - 1);
+    std::string message = name.substr(separator + 1);
+    if(message.size() > 2 && message.compare(message.size() - 2, 2, "[]") == 0) {
+      message.erase(message.size() - 2);
+      if(RTT::types::Types()->type("/" + package + "/" + message) == NULL && message.size() > 1 && message[0] == 'c') {
+        message.erase(0, 1);
+      }
+    }
+
+    // Find the loader of the typekit of this package
+    RTT::Service::shared_ptr lazy_typekits = lazyTypekitService();
+    if(!lazy_typekits->hasOperation(package)) {
+      RTT::log(RTT::Error) << "No lazily-loaded typekit for ROS package \"" << package << "\" has been imported." << RTT::endlog();
+      return false;
+    }
+    RTT::OperationCaller<bool(const std::string&)> load = lazy_typekits->getOperation(package);
+
+    return load("/" + package + "/" + message);
+  }
+
+  /** \brief Load all ROS message types from a typekit's factory table
+   *
+   * Types which have already been registered, for example by an earlier
+   * import of the same typekit, are skipped.
+   */
+  inline bool loadTypesFromFactories(
+      const TypekitFactory *begin,
+      const TypekitFactory *end)
+  {
+    RTT::types::TypeInfoRepository::shared_ptr types = RTT::types::Types();
+    for(const TypekitFactory *factory = begin; factory != end; ++factory) {
+      if(types->type(factory->name) == NULL) {
+        factory->add_type();
+      }
+    }
+    return true;
+  }
+
+  /** \brief Load a ROS message type from a typekit's factory table
+   *
+   * Message types which are used as fields of this type are loaded first, as
+   * they are needed to decompose it. They are read from the message
+   * definition.
+   */
+  inline bool loadTypeFromFactories(
+      const TypekitFactory *begin,
+      const TypekitFactory *end,
+      const std::string &name)
+  {
+    const TypekitFactory *factory = findFactory(begin, end, name);
+    if(factory == NULL) {
+      RTT::log(RTT::Error) << "Unknown ROS message type \"" << name << "\"." << RTT::endlog();
+      return false;
+    }
+
+    if(RTT::types::Types()->type(name) != NULL) {
+      return true;
+    }
+
+    // Load the types of all nested messages
+    bool success = true;
+    std::istringstream definition(factory->definition());
+    std::string line;
+    while(std::getline(definition, line)) {
+      if(line.compare(0, 5, "MSG: ") == 0) {
+        std::string nested = line.substr(5);
+        nested.erase(nested.find_last_not_of(" \t\r") + 1);
+        success = loadType(nested) && success;
+      }
+    }
+
+    RTT::log(RTT::Debug) << "Loading ROS message type \"" << name << "\" on demand." << RTT::endlog();
+    factory->add_type();
+    return success;
+  }
+}
+
+#endif // ifndef __RTT_ROSCOMM_RTT_ROSTYPEKIT_LOADER_HPP
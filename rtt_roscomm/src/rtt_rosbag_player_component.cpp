@@ -0,0 +1,312 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <rtt/Logger.hpp>
+#include <rtt/internal/GlobalService.hpp>
+#include <rtt/types/TypeInfoRepository.hpp>
+#include <rtt/Component.hpp>
+
+#include <rosbag/query.h>
+
+#include <rtt_roscomm/rtt_rostypekit_loader.hpp>
+#include <rtt_roscomm/rtt_rosbag_player.hpp>
+
+using namespace RTT;
+
+namespace rtt_roscomm {
+
+  //! Longest time the player sleeps in one updateHook(), so that it can be stopped
+  static const double MAX_SLEEP = 0.1;
+
+  RosbagPlayer::RosbagPlayer(std::string const& name) :
+    TaskContext(name, PreOperational),
+    prop_filename("recording.bag"),
+    prop_rate(1.0),
+    prop_sim_clock(true),
+    finished_(true)
+  {
+    this->addProperty("filename", prop_filename)
+      .doc("The bag file to play back. It is opened when the player is configured.");
+    this->addProperty("rate", prop_rate)
+      .doc("The playback speed as a multiple of real time, or 0 to play back as fast as possible.");
+    this->addProperty("sim_clock", prop_sim_clock)
+      .doc("Update the rtt_rosclock simulation clock to the time stamps of the played messages.");
+
+    this->addOperation("addTopic", &RosbagPlayer::addTopic, this)
+      .doc("Add an output port on which a topic of the bag is played back. The player must not be configured.")
+      .arg("topic", "The topic in the bag")
+      .arg("port_name", "The name of the new output port");
+
+    this->addOperation("isFinished", &RosbagPlayer::isFinished, this)
+      .doc("Check if the whole bag has been played back.");
+  }
+
+  RosbagPlayer::~RosbagPlayer()
+  {
+    this->stop();
+    this->cleanup();
+  }
+
+  bool RosbagPlayer::addTopic(const std::string &topic, const std::string &port_name)
+  {
+    Logger::In in(this->getName());
+
+    if(this->isConfigured()) {
+      log(Error) << "Topics can only be added before the player is configured." << endlog();
+      return false;
+    }
+
+    if(topics_.count(topic) > 0) {
+      log(Error) << "Topic \"" << topic << "\" is already played back." << endlog();
+      return false;
+    }
+
+    boost::shared_ptr<Playback> playback(new Playback());
+    playback->topic = topic;
+    playback->port_name = port_name;
+    playback->marshaller = NULL;
+    playback->messages = 0;
+
+    playbacks_.push_back(playback);
+    topics_[topic] = playback.get();
+
+    return true;
+  }
+
+  bool RosbagPlayer::isFinished() const
+  {
+    return finished_;
+  }
+
+  bool RosbagPlayer::createPort(Playback &playback, const rosbag::ConnectionInfo *connection)
+  {
+    // RTT type names of ROS messages have a leading slash
+    const std::string type_name = "/" + connection->datatype;
+
+    const types::TypeInfo *ti = types::TypeInfoRepository::Instance()->type(type_name);
+    if(!ti && rtt_roscomm::loadType(connection->datatype)) {
+      ti = types::TypeInfoRepository::Instance()->type(type_name);
+    }
+    if(!ti) {
+      log(Error) << "Unknown type \"" << connection->datatype << "\" of topic \"" << playback.topic << "\". Has its typekit been imported?" << endlog();
+      return false;
+    }
+
+    RosMsgMarshallerBase *marshaller = getRosMsgMarshaller(const_cast<types::TypeInfo*>(ti));
+    if(!marshaller) {
+      log(Error) << "Type \"" << ti->getTypeName() << "\" of topic \"" << playback.topic << "\" is not a ROS message type." << endlog();
+      return false;
+    }
+    if(marshaller->getMD5Sum() != connection->md5sum) {
+      log(Error) << "The definition of \"" << connection->datatype << "\" in the bag differs from the one in its typekit." << endlog();
+      return false;
+    }
+
+    // All connections of a topic have to have the same type
+    if(playback.port) {
+      if(playback.marshaller != marshaller) {
+        log(Error) << "Topic \"" << playback.topic << "\" has been recorded with different types." << endlog();
+        return false;
+      }
+      return true;
+    }
+
+    if(this->ports()->getPort(playback.port_name)) {
+      log(Error) << "The player already has a port named \"" << playback.port_name << "\"." << endlog();
+      return false;
+    }
+
+    playback.port.reset(ti->outputPort(playback.port_name));
+    playback.sample = ti->buildValue();
+    playback.marshaller = marshaller;
+
+    if(!playback.port || !playback.sample) {
+      log(Error) << "Could not create a port of type \"" << ti->getTypeName() << "\"." << endlog();
+      playback.port.reset();
+      return false;
+    }
+
+    playback.port->doc("Samples played back from topic " + playback.topic);
+    this->ports()->addPort(*playback.port);
+
+    return true;
+  }
+
+  bool RosbagPlayer::configureHook()
+  {
+    Logger::In in(this->getName());
+
+    if(prop_sim_clock) {
+      Service::shared_ptr ros = internal::GlobalService::Instance()->provides("ros");
+      if(!ros->hasService("clock")) {
+        log(Error) << "The simulation clock requires the \"ros.clock\" service. Has rtt_rosclock been imported?" << endlog();
+        return false;
+      }
+      Service::shared_ptr clock = ros->provides("clock");
+      use_manual_clock_ = clock->getOperation("useManualClock");
+      enable_sim_clock_ = clock->getOperation("enableSimClock");
+      update_sim_clock_ = clock->getOperation("updateSimClock");
+      if(!use_manual_clock_.ready() || !enable_sim_clock_.ready() || !update_sim_clock_.ready()) {
+        log(Error) << "Could not get the simulation clock operations of the \"ros.clock\" service." << endlog();
+        return false;
+      }
+    }
+
+    // Ask the kernel to read the bag ahead of the playback
+    int fd = ::open(prop_filename.c_str(), O_RDONLY);
+    if(fd >= 0) {
+      ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+      ::close(fd);
+    }
+
+    try {
+      bag_.open(prop_filename, rosbag::bagmode::Read);
+    } catch(rosbag::BagException &ex) {
+      log(Error) << "Could not open bag \"" << prop_filename << "\": " << ex.what() << endlog();
+      return false;
+    }
+
+    // Only the connections of the played topics are read
+    std::vector<std::string> topics;
+    for(std::vector<boost::shared_ptr<Playback> >::iterator it = playbacks_.begin(); it != playbacks_.end(); ++it) {
+      topics.push_back((*it)->topic);
+    }
+    view_.reset(new rosbag::View(bag_, rosbag::TopicQuery(topics)));
+
+    bool success = true;
+    std::vector<const rosbag::ConnectionInfo*> connections = view_->getConnections();
+    for(std::vector<const rosbag::ConnectionInfo*>::const_iterator it = connections.begin(); it != connections.end(); ++it) {
+      success = this->createPort(*topics_[(*it)->topic], *it) && success;
+    }
+
+    for(std::vector<boost::shared_ptr<Playback> >::iterator it = playbacks_.begin(); it != playbacks_.end(); ++it) {
+      if(!(*it)->port) {
+        log(Error) << "Bag \"" << prop_filename << "\" has no messages on topic \"" << (*it)->topic << "\"." << endlog();
+        success = false;
+      }
+    }
+
+    if(!success) {
+      this->cleanupHook();
+    }
+
+    return success;
+  }
+
+  bool RosbagPlayer::startHook()
+  {
+    Logger::In in(this->getName());
+
+    if(prop_sim_clock) {
+      use_manual_clock_();
+      if(!enable_sim_clock_()) {
+        log(Error) << "Could not enable the simulation clock." << endlog();
+        return false;
+      }
+    }
+
+    for(std::vector<boost::shared_ptr<Playback> >::iterator it = playbacks_.begin(); it != playbacks_.end(); ++it) {
+      (*it)->messages = 0;
+    }
+
+    next_ = view_->begin();
+    bag_start_ = view_->getBeginTime();
+    wall_start_ = ros::WallTime::now();
+    finished_ = false;
+
+    return this->trigger();
+  }
+
+  void RosbagPlayer::updateHook()
+  {
+    if(finished_) {
+      return;
+    }
+
+    if(next_ == view_->end()) {
+      log(Info) << "Finished playing back bag \"" << prop_filename << "\"." << endlog();
+      finished_ = true;
+      return;
+    }
+
+    const ros::Time stamp = next_->getTime();
+
+    // Wait for the wall time at which the messages are due
+    if(prop_rate > 0.0) {
+      const ros::WallTime due = wall_start_ + ros::WallDuration((stamp - bag_start_).toSec() / prop_rate);
+      const ros::WallDuration remaining = due - ros::WallTime::now();
+      if(remaining.toSec() > MAX_SLEEP) {
+        ros::WallDuration(MAX_SLEEP).sleep();
+        this->trigger();
+        return;
+      } else if(remaining.toSec() > 0.0) {
+        remaining.sleep();
+      }
+    }
+
+    // Write all messages of this time stamp before the components step
+    while(next_ != view_->end() && next_->getTime() == stamp) {
+      this->write(*next_);
+      ++next_;
+    }
+
+    if(prop_sim_clock) {
+      update_sim_clock_(stamp);
+    }
+
+    this->trigger();
+  }
+
+  void RosbagPlayer::write(const rosbag::MessageInstance &message)
+  {
+    std::map<std::string, Playback*>::iterator it = topics_.find(message.getTopic());
+    if(it == topics_.end()) {
+      return;
+    }
+    Playback &playback = *it->second;
+
+    const uint32_t size = message.size();
+    if(size > buffer_.size()) {
+      buffer_.resize(size);
+    }
+
+    ros::serialization::OStream stream(buffer_.empty() ? NULL : &buffer_[0], size);
+    message.write(stream);
+
+    if(!playback.marshaller->updateFromBlob(buffer_.empty() ? NULL : &buffer_[0], size, playback.sample, NULL)) {
+      log(Error) << "Could not deserialize a message of topic \"" << playback.topic << "\"." << endlog();
+      return;
+    }
+
+    playback.port->write(playback.sample);
+    playback.messages++;
+  }
+
+  void RosbagPlayer::stopHook()
+  {
+    Logger::In in(this->getName());
+
+    for(std::vector<boost::shared_ptr<Playback> >::iterator it = playbacks_.begin(); it != playbacks_.end(); ++it) {
+      log(Info) << "Played back " << (*it)->messages << " messages on topic \"" << (*it)->topic << "\"." << endlog();
+    }
+
+    finished_ = true;
+  }
+
+  void RosbagPlayer::cleanupHook()
+  {
+    for(std::vector<boost::shared_ptr<Playback> >::iterator it = playbacks_.begin(); it != playbacks_.end(); ++it) {
+      if((*it)->port) {
+        this->ports()->removePort((*it)->port_name);
+        (*it)->port.reset();
+        (*it)->sample.reset();
+        (*it)->marshaller = NULL;
+      }
+    }
+
+    view_.reset();
+    bag_.close();
+  }
+}
+
+ORO_LIST_COMPONENT_TYPE(rtt_roscomm::RosbagPlayer)
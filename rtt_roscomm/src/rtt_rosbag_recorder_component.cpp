@@ -0,0 +1,327 @@
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/falloc.h>
+#endif
+
+#include <rtt/Logger.hpp>
+#include <rtt/ConnPolicy.hpp>
+#include <rtt/base/OutputPortInterface.hpp>
+#include <rtt/types/TypeInfoRepository.hpp>
+#include <rtt/Component.hpp>
+
+#include <ros/ros.h>
+
+#include <rtt_roscomm/rtt_rostypekit_loader.hpp>
+#include <rtt_roscomm/rtt_rosbag_recorder.hpp>
+
+using namespace RTT;
+
+namespace rtt_roscomm {
+
+  RosbagRecorder::RosbagRecorder(std::string const& name) :
+    TaskContext(name, PreOperational),
+    prop_filename("recording.bag"),
+    prop_compression("lz4"),
+    prop_chunk_threshold(768 * 1024),
+    prop_buffer_size(100),
+    prop_preallocation(64 * 1024 * 1024),
+    fd_(-1),
+    allocated_(0)
+  {
+    this->addProperty("filename", prop_filename)
+      .doc("The bag file to write. It is overwritten when the recorder is started.");
+    this->addProperty("compression", prop_compression)
+      .doc("The compression of bag chunks: \"none\", \"bz2\" or \"lz4\".");
+    this->addProperty("chunk_threshold", prop_chunk_threshold)
+      .doc("The size in bytes of the uncompressed bag chunks.");
+    this->addProperty("buffer_size", prop_buffer_size)
+      .doc("The length of the lock-free buffers of the connections created by record().");
+    this->addProperty("preallocation", prop_preallocation)
+      .doc("The size in bytes of the extents by which the bag file is grown, or 0 to let the file system allocate it.");
+
+    this->addOperation("record", &RosbagRecorder::record, this)
+      .doc("Record a port of a peer component. The recorder must be stopped.")
+      .arg("port_name", "The port to record, like \"peer.port\"")
+      .arg("topic", "The topic under which the samples are stored in the bag");
+
+    this->addOperation("addTopic", &RosbagRecorder::addTopic, this)
+      .doc("Add an input port which is recorded. The recorder must be stopped.")
+      .arg("port_name", "The name of the new input port")
+      .arg("type_name", "The ROS message type, like \"std_msgs/Header\"")
+      .arg("topic", "The topic under which the samples are stored in the bag");
+  }
+
+  RosbagRecorder::~RosbagRecorder()
+  {
+    this->stop();
+    for(std::vector<boost::shared_ptr<Recording> >::iterator it = recordings_.begin(); it != recordings_.end(); ++it) {
+      this->ports()->removePort((*it)->port->getName());
+    }
+  }
+
+  bool RosbagRecorder::record(const std::string &port_name, const std::string &topic)
+  {
+    Logger::In in(this->getName());
+
+    const std::string::size_type dot = port_name.rfind('.');
+    if(dot == std::string::npos) {
+      log(Error) << "Port name \"" << port_name << "\" is not of the form \"peer.port\"." << endlog();
+      return false;
+    }
+
+    TaskContext *peer = this->getPeer(port_name.substr(0, dot));
+    if(!peer) {
+      log(Error) << "\"" << port_name.substr(0, dot) << "\" is not a peer of " << this->getName() << "." << endlog();
+      return false;
+    }
+
+    base::OutputPortInterface *output =
+      dynamic_cast<base::OutputPortInterface*>(peer->ports()->getPort(port_name.substr(dot + 1)));
+    if(!output) {
+      log(Error) << "\"" << port_name << "\" is not an output port." << endlog();
+      return false;
+    }
+
+    // Name the input port after the topic
+    std::string input_name = topic;
+    for(std::string::iterator c = input_name.begin(); c != input_name.end(); ++c) {
+      if(*c == '/' || *c == '~') {
+        *c = '_';
+      }
+    }
+    input_name.erase(0, input_name.find_first_not_of('_'));
+
+    Recording *recording = this->addRecording(input_name, output->getTypeInfo(), topic);
+    if(!recording) {
+      return false;
+    }
+
+    if(!output->connectTo(recording->port.get(), ConnPolicy::buffer(prop_buffer_size, ConnPolicy::LOCK_FREE))) {
+      log(Error) << "Could not connect \"" << port_name << "\" to the recorder." << endlog();
+      this->ports()->removePort(input_name);
+      recordings_.pop_back();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool RosbagRecorder::addTopic(const std::string &port_name, const std::string &type_name, const std::string &topic)
+  {
+    Logger::In in(this->getName());
+
+    // RTT type names of ROS messages have a leading slash
+    const std::string rtt_type_name = (type_name.empty() || type_name[0] == '/') ? type_name : "/" + type_name;
+
+    const types::TypeInfo *ti = types::TypeInfoRepository::Instance()->type(rtt_type_name);
+    if(!ti && rtt_roscomm::loadType(rtt_type_name.substr(1))) {
+      ti = types::TypeInfoRepository::Instance()->type(rtt_type_name);
+    }
+    if(!ti) {
+      log(Error) << "Unknown type \"" << type_name << "\". Has its typekit been imported?" << endlog();
+      return false;
+    }
+
+    return this->addRecording(port_name, ti, topic) != NULL;
+  }
+
+  RosbagRecorder::Recording *RosbagRecorder::addRecording(
+      const std::string &port_name,
+      const types::TypeInfo *ti,
+      const std::string &topic)
+  {
+    if(this->isRunning()) {
+      log(Error) << "Topics can only be added while the recorder is stopped." << endlog();
+      return NULL;
+    }
+
+    if(this->ports()->getPort(port_name)) {
+      log(Error) << "The recorder already has a port named \"" << port_name << "\"." << endlog();
+      return NULL;
+    }
+
+    RosMsgMarshallerBase *marshaller = getRosMsgMarshaller(const_cast<types::TypeInfo*>(ti));
+    if(!marshaller) {
+      log(Error) << "Type \"" << ti->getTypeName() << "\" of topic \"" << topic << "\" is not a ROS message type." << endlog();
+      return NULL;
+    }
+
+    boost::shared_ptr<Recording> recording(new Recording());
+    recording->topic = topic;
+    recording->port.reset(ti->inputPort(port_name));
+    recording->sample = ti->buildValue();
+    recording->marshaller = marshaller;
+    recording->md5sum = marshaller->getMD5Sum();
+    recording->datatype = marshaller->getDataType();
+    recording->definition = marshaller->getMessageDefinition();
+    recording->messages = 0;
+    recording->bytes = 0;
+
+    if(!recording->port || !recording->sample) {
+      log(Error) << "Could not create a port of type \"" << ti->getTypeName() << "\"." << endlog();
+      return NULL;
+    }
+
+    recording->port->doc("Samples recorded on topic " + topic);
+    this->addEventPort(*recording->port);
+    recordings_.push_back(recording);
+
+    return recording.get();
+  }
+
+  bool RosbagRecorder::configureHook()
+  {
+    Logger::In in(this->getName());
+
+    if(prop_compression != "none" && prop_compression != "bz2" && prop_compression != "lz4") {
+      log(Error) << "Unknown compression \"" << prop_compression << "\"." << endlog();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool RosbagRecorder::startHook()
+  {
+    Logger::In in(this->getName());
+
+    try {
+      bag_.open(prop_filename, rosbag::bagmode::Write);
+    } catch(rosbag::BagException &ex) {
+      log(Error) << "Could not open bag \"" << prop_filename << "\": " << ex.what() << endlog();
+      return false;
+    }
+
+    if(prop_compression == "bz2") {
+      bag_.setCompression(rosbag::compression::BZ2);
+    } else if(prop_compression == "lz4") {
+      bag_.setCompression(rosbag::compression::LZ4);
+    } else {
+      bag_.setCompression(rosbag::compression::Uncompressed);
+    }
+    bag_.setChunkThreshold(prop_chunk_threshold);
+
+    allocated_ = 0;
+    if(prop_preallocation > 0) {
+      fd_ = ::open(prop_filename.c_str(), O_WRONLY);
+      this->preallocate(prop_preallocation);
+    }
+
+    for(std::vector<boost::shared_ptr<Recording> >::iterator it = recordings_.begin(); it != recordings_.end(); ++it) {
+      (*it)->messages = 0;
+      (*it)->bytes = 0;
+    }
+
+    return true;
+  }
+
+  void RosbagRecorder::updateHook()
+  {
+    for(std::vector<boost::shared_ptr<Recording> >::iterator it = recordings_.begin(); it != recordings_.end(); ++it) {
+      this->drain(**it);
+    }
+
+    // Grow the file before the next chunk can reach the end of the allocated extents
+    if(fd_ >= 0 && bag_.getSize() + 2 * static_cast<uint64_t>(prop_chunk_threshold) > allocated_) {
+      this->preallocate(allocated_ + prop_preallocation);
+    }
+  }
+
+  void RosbagRecorder::drain(Recording &recording)
+  {
+    while(recording.port->read(recording.sample, false) == NewData) {
+      std::pair<void const*, int> blob = recording.marshaller->fillBlob(
+          recording.sample,
+          recording.buffer.empty() ? NULL : &recording.buffer[0],
+          recording.buffer.size(),
+          NULL);
+
+      // Only grow the buffer if the sample does not fit
+      if(blob.second < 0) {
+        const unsigned int size = recording.marshaller->getSampleSize(recording.sample);
+        if(size > recording.buffer.size()) {
+          recording.buffer.resize(size);
+          blob = recording.marshaller->fillBlob(recording.sample, &recording.buffer[0], recording.buffer.size(), NULL);
+        }
+      }
+
+      if(blob.second < 0) {
+        log(Error) << "Could not serialize a sample of topic \"" << recording.topic << "\"." << endlog();
+        continue;
+      }
+
+      // Write the serialized sample as it is
+      SerializedMessage message;
+      message.md5sum = &recording.md5sum;
+      message.datatype = &recording.datatype;
+      message.definition = &recording.definition;
+      message.data = static_cast<const uint8_t*>(blob.first);
+      message.size = blob.second;
+
+      try {
+        bag_.write(recording.topic, ros::Time::now(), message);
+      } catch(rosbag::BagException &ex) {
+        log(Error) << "Could not write to bag \"" << prop_filename << "\": " << ex.what() << endlog();
+        return;
+      }
+
+      recording.messages++;
+      recording.bytes += blob.second;
+    }
+  }
+
+  void RosbagRecorder::preallocate(uint64_t size)
+  {
+#ifdef __linux__
+    // Allocate the blocks without changing the file size, which rosbag relies on
+    if(fd_ >= 0 && ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, allocated_, size - allocated_) == 0) {
+      allocated_ = size;
+      return;
+    }
+    log(Warning) << "Could not preallocate bag \"" << prop_filename << "\": " << std::strerror(errno) << endlog();
+#endif
+    // Don't try again
+    if(fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  void RosbagRecorder::stopHook()
+  {
+    Logger::In in(this->getName());
+
+    for(std::vector<boost::shared_ptr<Recording> >::iterator it = recordings_.begin(); it != recordings_.end(); ++it) {
+      this->drain(**it);
+    }
+
+    bag_.close();
+
+    if(fd_ >= 0) {
+#ifdef __linux__
+      // Release the extents behind the index which has been written on close
+      struct stat st;
+      if(::fstat(fd_, &st) == 0 && allocated_ > static_cast<uint64_t>(st.st_size)) {
+        ::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, st.st_size, allocated_ - st.st_size);
+      }
+#endif
+      ::close(fd_);
+      fd_ = -1;
+    }
+
+    for(std::vector<boost::shared_ptr<Recording> >::iterator it = recordings_.begin(); it != recordings_.end(); ++it) {
+      log(Info) << "Recorded " << (*it)->messages << " messages (" << (*it)->bytes << " bytes) on topic \"" << (*it)->topic << "\"." << endlog();
+    }
+  }
+}
+
+/*
+ * The bag components share one component library.
+ */
+ORO_CREATE_COMPONENT_LIBRARY()
+ORO_LIST_COMPONENT_TYPE(rtt_roscomm::RosbagRecorder)
@@ -1,4 +1,8 @@
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <ros/ros.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 
 #include <rtt/RTT.hpp>
 #include <rtt/plugin/ServicePlugin.hpp>
@@ -21,6 +25,7 @@ public:
    */
   ROSServiceService(TaskContext* owner) 
     : Service("rosservice", owner)
+    , tracing_(false)
   {
     if(owner) {
       this->doc("RTT Service for connecting the operations of "+owner->getName()+" to ROS service clients and servers.");
@@ -32,6 +37,16 @@ public:
       .arg( "service_name", "The ROS service name (like \"/my_robot/ns/some_service\").")
       .arg( "service_type", "The ROS service type (like \"std_srvs/Empty\").");
 
+    this->addOperation("setTracing", &ROSServiceService::setTracing, this)
+      .doc( "Enables or disables measuring how long ROS service calls wait for this component's ExecutionEngine. This queues a marker message in the engine ahead of each call.")
+      .arg( "tracing", "True to measure the waiting time.");
+    this->addOperation("printStatistics", &ROSServiceService::printStatistics, this)
+      .doc( "Logs the call counts and timings of all ROS service proxies of this component.");
+    this->addOperation("resetStatistics", &ROSServiceService::resetStatistics, this)
+      .doc( "Resets the call counts and timings of all ROS service proxies of this component.");
+    this->addOperation("publishStatistics", &ROSServiceService::publishStatistics, this)
+      .doc( "Publishes the call counts and timings of all ROS service proxies of this component on the /diagnostics topic.");
+
     // Get the global ros service registry
     rosservice_registry_ = ROSServiceRegistryService::Instance();
     has_service_factory = rosservice_registry_->getOperation("hasServiceFactory");
@@ -140,6 +155,7 @@ public:
         // Create a new server proxy
         server_proxies_[ros_service_name] =
           get_service_factory(ros_service_type)->create_server_proxy(ros_service_name);
+        server_proxies_[ros_service_name]->setTracing(tracing_);
       }
 
       // Associate an RTT operation with a ROS service server 
@@ -154,12 +170,122 @@ public:
     return false;
   }
 
+  //! Enable or disable tracing of the time calls wait for the owner's engine
+  void setTracing(bool tracing)
+  {
+    tracing_ = tracing;
+    for(std::map<std::string, ROSServiceServerProxyBase*>::iterator it = server_proxies_.begin();
+        it != server_proxies_.end();
+        ++it)
+    {
+      it->second->setTracing(tracing);
+    }
+  }
+
+  //! Log the statistics of one phase
+  static void printTiming(const std::string &name, const ROSServiceTiming &timing)
+  {
+    if(timing.count == 0) {
+      return;
+    }
+    RTT::log(RTT::Info) << "    " << name << ": mean " << timing.mean() << " s, min " << timing.min
+      << " s, max " << timing.max << " s, last " << timing.last << " s" << RTT::endlog();
+  }
+
+  //! Log the statistics of one proxy
+  void printProxyStatistics(const std::string &kind, ROSServiceProxyBase *proxy)
+  {
+    const ROSServiceProxyStatistics statistics = proxy->getStatistics();
+    RTT::log(RTT::Info) << " -- " << kind << " \"" << proxy->getServiceName() << "\": "
+      << statistics.calls << " calls, " << statistics.errors << " errors" << RTT::endlog();
+    printTiming("network", statistics.network);
+    printTiming("wait", statistics.wait);
+    printTiming("execute", statistics.execute);
+  }
+
+  //! Log the statistics of all proxies
+  void printStatistics()
+  {
+    RTT::log(RTT::Info) << "ROS service proxy statistics of " << getOwner()->getName() << ":" << RTT::endlog();
+    for(std::map<std::string, ROSServiceServerProxyBase*>::iterator it = server_proxies_.begin(); it != server_proxies_.end(); ++it) {
+      printProxyStatistics("server", it->second);
+    }
+    for(std::map<std::string, ROSServiceClientProxyBase*>::iterator it = client_proxies_.begin(); it != client_proxies_.end(); ++it) {
+      printProxyStatistics("client", it->second);
+    }
+  }
+
+  //! Reset the statistics of all proxies
+  void resetStatistics()
+  {
+    for(std::map<std::string, ROSServiceServerProxyBase*>::iterator it = server_proxies_.begin(); it != server_proxies_.end(); ++it) {
+      it->second->resetStatistics();
+    }
+    for(std::map<std::string, ROSServiceClientProxyBase*>::iterator it = client_proxies_.begin(); it != client_proxies_.end(); ++it) {
+      it->second->resetStatistics();
+    }
+  }
+
+  //! Append the statistics of one phase to a diagnostic status
+  static void appendTiming(diagnostic_msgs::DiagnosticStatus &status, const std::string &name, const ROSServiceTiming &timing)
+  {
+    if(timing.count == 0) {
+      return;
+    }
+    diagnostic_msgs::KeyValue kv;
+    kv.key = name + " mean"; kv.value = boost::lexical_cast<std::string>(timing.mean()); status.values.push_back(kv);
+    kv.key = name + " min"; kv.value = boost::lexical_cast<std::string>(timing.min); status.values.push_back(kv);
+    kv.key = name + " max"; kv.value = boost::lexical_cast<std::string>(timing.max); status.values.push_back(kv);
+    kv.key = name + " last"; kv.value = boost::lexical_cast<std::string>(timing.last); status.values.push_back(kv);
+  }
+
+  diagnostic_msgs::DiagnosticStatus getStatus(const std::string &kind, ROSServiceProxyBase *proxy)
+  {
+    const ROSServiceProxyStatistics statistics = proxy->getStatistics();
+
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = getOwner()->getName() + ": " + proxy->getServiceName();
+    status.message = "ROS service " + kind + " proxy";
+    status.level = (statistics.errors > 0) ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+
+    diagnostic_msgs::KeyValue kv;
+    kv.key = "calls"; kv.value = boost::lexical_cast<std::string>(statistics.calls); status.values.push_back(kv);
+    kv.key = "errors"; kv.value = boost::lexical_cast<std::string>(statistics.errors); status.values.push_back(kv);
+    appendTiming(status, "network", statistics.network);
+    appendTiming(status, "wait", statistics.wait);
+    appendTiming(status, "execute", statistics.execute);
+
+    return status;
+  }
+
+  //! Publish the statistics of all proxies on the /diagnostics topic
+  void publishStatistics()
+  {
+    if(!diagnostics_publisher_) {
+      ros::NodeHandle nh;
+      diagnostics_publisher_ = nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+    }
+
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time::now();
+    for(std::map<std::string, ROSServiceServerProxyBase*>::iterator it = server_proxies_.begin(); it != server_proxies_.end(); ++it) {
+      diagnostics.status.push_back(getStatus("server", it->second));
+    }
+    for(std::map<std::string, ROSServiceClientProxyBase*>::iterator it = client_proxies_.begin(); it != client_proxies_.end(); ++it) {
+      diagnostics.status.push_back(getStatus("client", it->second));
+    }
+    diagnostics_publisher_.publish(diagnostics);
+  }
+
   RTT::Service::shared_ptr rosservice_registry_;
   RTT::OperationCaller<bool(const std::string&)> has_service_factory;
   RTT::OperationCaller<ROSServiceProxyFactoryBase*(const std::string&)> get_service_factory;
 
   std::map<std::string, ROSServiceServerProxyBase*> server_proxies_;
   std::map<std::string, ROSServiceClientProxyBase*> client_proxies_;
+
+  bool tracing_;
+  ros::Publisher diagnostics_publisher_;
 };
 
 ORO_SERVICE_NAMED_PLUGIN(ROSServiceService, "rosservice")
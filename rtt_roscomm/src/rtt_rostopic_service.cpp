@@ -1,6 +1,8 @@
 #include <rtt/RTT.hpp>
 #include <rtt/internal/GlobalService.hpp>
 #include <rtt_roscomm/rtt_rostopic.h> 
+#include <rtt_roscomm/rtt_rostypekit_loader.hpp>
+#include <rtt_roscomm/rtt_rosmsg_marshaller.hpp>
 
 using namespace RTT;
 using namespace std;
@@ -11,6 +13,7 @@ void loadROSTopicService(){
 
   // New topic construction operators
   roscomm->addConstant("protocol_id", rtt_roscomm::protocol_id);
+  roscomm->addConstant("serialization_protocol_id", rtt_roscomm::serialization_protocol_id);
 
   roscomm->addOperation("topic", &rtt_roscomm::topic).doc(
       "Creates a ConnPolicy for subscribing to or publishing a topic. No buffering is done, only the last message is kept.").arg(
@@ -25,6 +28,10 @@ void loadROSTopicService(){
       "Creates a ConnPolicy for unbuffered publishing a topic. This may not be real-time safe!").arg(
           "name", "The ros topic name");
 
+  roscomm->addOperation("loadType", &rtt_roscomm::loadType).doc(
+      "Loads a ROS message type and the types it depends on from a lazily-loaded typekit.").arg(
+          "name", "The ROS message type, like \"std_msgs/Header\"");
+
   // Backwards-compatibility
   ros->addConstant("protocol_id", rtt_roscomm::protocol_id);
 
@@ -0,0 +1,150 @@
+/** Copyright (c) 2013, Jonathan Bohren, all rights reserved.
+ * This software is released under the BSD 3-clause license, for the details of
+ * this license, please see LICENSE.txt at the root of this repository.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <rtt/os/startstop.h>
+#include <rtt/os/TimeService.hpp>
+
+#include <kdl_conversions/kdl_msg.h>
+#include <rtt_kdl_conversions/kdl_bulk_conversions.h>
+
+#include <gtest/gtest.h>
+
+//! Number of poses in the converted arrays, odd to also cover the scalar tail
+static const size_t N_POSES = 1001;
+
+class BulkConversionsBenchmark : public ::testing::Test
+{
+protected:
+  virtual void SetUp() {
+    std::srand(0);
+    poses.resize(N_POSES);
+    for(size_t i=0; i < N_POSES; i++) {
+      geometry_msgs::Pose &pose = poses[i];
+      pose.position.x = random();
+      pose.position.y = random();
+      pose.position.z = random();
+
+      const double x = random(), y = random(), z = random(), w = random();
+      const double norm = std::sqrt(x*x + y*y + z*z + w*w);
+      pose.orientation.x = x / norm;
+      pose.orientation.y = y / norm;
+      pose.orientation.z = z / norm;
+      pose.orientation.w = w / norm;
+    }
+  }
+
+  static double random() { return 2.0 * std::rand() / RAND_MAX - 1.0; }
+
+  //! Convert all poses like components did before the bulk conversions
+  void scalarMsgToKDL(std::vector<KDL::Frame> &frames) const {
+    frames.resize(poses.size());
+    for(size_t i=0; i < poses.size(); i++) {
+      tf::poseMsgToKDL(poses[i], frames[i]);
+    }
+  }
+
+  std::vector<geometry_msgs::Pose> poses;
+};
+
+TEST_F(BulkConversionsBenchmark, MatchesScalarConversions)
+{
+  std::vector<KDL::Frame> expected, frames;
+  scalarMsgToKDL(expected);
+  rtt_kdl_conversions::posesMsgToKDL(poses, frames);
+
+  ASSERT_EQ(expected.size(), frames.size());
+  for(size_t i=0; i < frames.size(); i++) {
+    for(int j=0; j < 9; j++) {
+      EXPECT_EQ(expected[i].M.data[j], frames[i].M.data[j]);
+    }
+    for(int j=0; j < 3; j++) {
+      EXPECT_EQ(expected[i].p.data[j], frames[i].p.data[j]);
+    }
+  }
+
+  std::vector<geometry_msgs::Transform> transforms(poses.size());
+  for(size_t i=0; i < poses.size(); i++) {
+    tf::transformKDLToMsg(expected[i], transforms[i]);
+  }
+  rtt_kdl_conversions::transformsMsgToKDL(transforms, frames);
+  for(size_t i=0; i < frames.size(); i++) {
+    EXPECT_TRUE(KDL::Equal(expected[i], frames[i], 1e-12));
+  }
+
+  std::vector<geometry_msgs::Pose> round_trip;
+  rtt_kdl_conversions::posesKDLToMsg(frames, round_trip);
+  ASSERT_EQ(poses.size(), round_trip.size());
+  for(size_t i=0; i < poses.size(); i++) {
+    EXPECT_NEAR(poses[i].position.x, round_trip[i].position.x, 1e-12);
+    // q and -q are the same rotation
+    const double dot =
+      poses[i].orientation.x * round_trip[i].orientation.x +
+      poses[i].orientation.y * round_trip[i].orientation.y +
+      poses[i].orientation.z * round_trip[i].orientation.z +
+      poses[i].orientation.w * round_trip[i].orientation.w;
+    EXPECT_NEAR(1.0, std::fabs(dot), 1e-9);
+  }
+}
+
+TEST_F(BulkConversionsBenchmark, JointTrajectory)
+{
+  trajectory_msgs::JointTrajectory trajectory;
+  trajectory.points.resize(3);
+  for(size_t i=0; i < trajectory.points.size(); i++) {
+    trajectory.points[i].positions.resize(7, static_cast<double>(i));
+  }
+  trajectory.points[2].positions.resize(2);
+
+  std::vector<KDL::JntArray> positions;
+  rtt_kdl_conversions::jointTrajectoryMsgToKDL(trajectory, positions);
+
+  ASSERT_EQ(3U, positions.size());
+  EXPECT_EQ(7U, positions[0].rows());
+  EXPECT_EQ(7U, positions[1].rows());
+  EXPECT_EQ(2U, positions[2].rows());
+  EXPECT_EQ(1.0, positions[1](6));
+  EXPECT_EQ(2.0, positions[2](1));
+}
+
+TEST_F(BulkConversionsBenchmark, PosesMsgToKDL)
+{
+  const size_t n_rounds = 1000;
+  std::vector<KDL::Frame> frames;
+  double sum = 0.0;
+
+  RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+  for(size_t round=0; round < n_rounds; round++) {
+    scalarMsgToKDL(frames);
+    sum += frames[round % N_POSES].M.data[round % 9];
+  }
+  const RTT::Seconds scalar = RTT::os::TimeService::Instance()->secondsSince(start);
+
+  start = RTT::os::TimeService::Instance()->getTicks();
+  for(size_t round=0; round < n_rounds; round++) {
+    rtt_kdl_conversions::posesMsgToKDL(poses, frames);
+    sum -= frames[round % N_POSES].M.data[round % 9];
+  }
+  const RTT::Seconds bulk = RTT::os::TimeService::Instance()->secondsSince(start);
+
+  // Both loops convert the same poses
+  EXPECT_NEAR(0.0, sum, 1e-9);
+
+  std::cerr << "[ BENCHMARK] " << n_rounds << " conversions of " << N_POSES << " poses: "
+    << "scalar " << scalar << " s, bulk " << bulk << " s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  // Initialize Orocos
+  __os_init(argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,118 @@
+/** Copyright (c) 2013, Jonathan Bohren, all rights reserved.
+ * This software is released under the BSD 3-clause license, for the details of
+ * this license, please see LICENSE.txt at the root of this repository.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/os/startstop.h>
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <rosgraph_msgs/Clock.h>
+
+#include <rtt_rosclock/rtt_rosclock.h>
+#include <rtt_rosclock/rtt_rosclock_sim_clock_activity.h>
+#include <rtt_rosclock/rtt_rosclock_sim_clock_thread.h>
+
+#include <gtest/gtest.h>
+
+static const std::string ACK_TOPIC = "/rtt_rosclock_tests/clock_ack";
+
+//! A component which remembers the time at which it was last updated
+class ClockComponent : public RTT::TaskContext
+{
+public:
+  ClockComponent(const std::string &name) :
+    RTT::TaskContext(name)
+  {
+    this->setActivity(new rtt_rosclock::SimClockActivity(0.0));
+  }
+
+  virtual void updateHook() {
+    processed = rtt_rosclock::rtt_now();
+  }
+
+  ros::Time processed;
+};
+
+//! Collects the acknowledged times
+class AckListener
+{
+public:
+  void ackCallback(const rosgraph_msgs::ClockConstPtr &ack) {
+    acks.push_back(ack->clock);
+  }
+
+  //! Process callbacks until \a n acknowledgements have arrived or five seconds have passed
+  bool waitForAcks(ros::CallbackQueue &queue, size_t n) {
+    const ros::WallTime timeout = ros::WallTime::now() + ros::WallDuration(5.0);
+    while(acks.size() < n && ros::WallTime::now() < timeout) {
+      queue.callAvailable(ros::WallDuration(0.01));
+    }
+    return acks.size() >= n;
+  }
+
+  std::vector<ros::Time> acks;
+};
+
+TEST(LockStepTest, AcknowledgesUpdates)
+{
+  if(!ros::master::check()) {
+    std::cerr << "[ SKIPPED  ] No ROS master running." << std::endl;
+    return;
+  }
+
+  // Receive the acknowledgements in this thread only
+  ros::CallbackQueue queue;
+  ros::NodeHandle nh;
+  nh.setCallbackQueue(&queue);
+  AckListener listener;
+  ros::Subscriber subscriber = nh.subscribe(ACK_TOPIC, 10, &AckListener::ackCallback, &listener);
+
+  ClockComponent component("clock_component");
+  ASSERT_TRUE(component.start());
+
+  ASSERT_TRUE(rtt_rosclock::set_sim_clock_lock_step_topic(ACK_TOPIC));
+  rtt_rosclock::use_manual_clock();
+  ASSERT_TRUE(rtt_rosclock::enable_sim());
+
+  // The topic cannot be changed while the simulation clock is enabled
+  EXPECT_FALSE(rtt_rosclock::set_sim_clock_lock_step_topic("/rtt_rosclock_tests/other_ack"));
+  EXPECT_EQ(ACK_TOPIC, rtt_rosclock::SimClockThread::Instance()->getLockStepTopic());
+
+  // Wait for the acknowledgement publisher, so that no acknowledgement is lost
+  const ros::WallTime timeout = ros::WallTime::now() + ros::WallDuration(5.0);
+  while(subscriber.getNumPublishers() == 0 && ros::WallTime::now() < timeout) {
+    ros::WallDuration(0.01).sleep();
+  }
+  ASSERT_EQ(1U, subscriber.getNumPublishers());
+
+  // Each update is acknowledged with the time the component has processed
+  for(size_t i=1; i <= 5; i++) {
+    const ros::Time time(100 + i, 0);
+    rtt_rosclock::update_sim_clock(time);
+    EXPECT_EQ(time, component.processed);
+
+    ASSERT_TRUE(listener.waitForAcks(queue, i));
+    EXPECT_EQ(time, listener.acks.back());
+  }
+
+  EXPECT_TRUE(rtt_rosclock::disable_sim());
+  EXPECT_TRUE(rtt_rosclock::set_sim_clock_lock_step_topic(""));
+  component.stop();
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  // Initialize Orocos
+  __os_init(argc, argv);
+
+  ros::init(argc, argv, "rtt_rosclock_lock_step_test", ros::init_options::AnonymousName | ros::init_options::NoSigintHandler);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,229 @@
+/** Copyright (c) 2013, Jonathan Bohren, all rights reserved.
+ * This software is released under the BSD 3-clause license, for the details of
+ * this license, please see LICENSE.txt at the root of this repository.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include <rtt/os/startstop.h>
+#include <rtt/os/TimeService.hpp>
+#include <rtt/os/Time.hpp>
+
+#include <rtt_rosclock/rtt_rosclock.h>
+#include <rtt_rosclock/prof.h>
+#include <rtt_rosclock/rtt_rosclock_profiler.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <gtest/gtest.h>
+
+//! The WallProf which kept every measurement in a list, for comparison
+class ListWallProf {
+public:
+  typedef std::pair<ros::Time, ros::Time> TicToc;
+
+  ListWallProf(double memory) : memory_(memory) { }
+
+  void add(const ros::Time &tic, const ros::Time &toc)
+  {
+    tictocs_.push_back(std::make_pair(tic, toc));
+    while(tictocs_.size() > 1 && (toc - tictocs_.front().first).toSec() > memory_) {
+      tictocs_.pop_front();
+    }
+  }
+
+  void analyze()
+  {
+    double sum = 0.0;
+    double count = tictocs_.size();
+
+    max_ = 0;
+    min_ = tictocs_.back().second.toSec();
+
+    for(std::list<TicToc>::const_iterator it=tictocs_.begin(); it!=tictocs_.end(); ++it) {
+      const double tictoc = (it->second - it->first).toSec();
+      sum += tictoc;
+      max_ = std::max(max_, tictoc);
+      min_ = std::min(min_, tictoc);
+    }
+
+    mean_ = sum/count;
+
+    double err_sum = 0.0;
+    for(std::list<TicToc>::const_iterator it=tictocs_.begin(); it!=tictocs_.end(); ++it) {
+      const double tictoc = (it->second - it->first).toSec();
+      err_sum += std::pow(mean_ - tictoc, 2.0);
+    }
+
+    stddev_ = sqrt(err_sum/count);
+  }
+
+  double mean_, min_, max_, stddev_;
+  std::list<TicToc> tictocs_;
+
+private:
+  double memory_;
+};
+
+class ProfBenchmark : public ::testing::Test
+{
+protected:
+  //! Simulate a 1kHz loop whose updates take 100us to 200us, with rare 5ms outliers
+  virtual void SetUp() {
+    std::srand(0);
+    ros::Time tic(1000, 0);
+    for(size_t i=0; i < 20000; i++) {
+      tic += ros::Duration(0.001);
+      const double duration = (i % 1000 == 999) ? 0.005 : 100e-6 + 100e-6 * std::rand() / RAND_MAX;
+      tictocs.push_back(std::make_pair(tic, tic + ros::Duration(duration)));
+    }
+  }
+
+  std::vector<std::pair<ros::Time, ros::Time> > tictocs;
+};
+
+TEST_F(ProfBenchmark, MatchesListStatistics)
+{
+  // Both keep the last second of measurements
+  rtt_rosclock::WallProf prof(1.0, 2000);
+  ListWallProf list_prof(1.0);
+
+  for(size_t i=0; i < tictocs.size(); i++) {
+    prof.add(tictocs[i].first, tictocs[i].second);
+    list_prof.add(tictocs[i].first, tictocs[i].second);
+
+    if(i % 1000 == 500) {
+      prof.analyze();
+      list_prof.analyze();
+      ASSERT_EQ(list_prof.tictocs_.size(), prof.n());
+      EXPECT_NEAR(list_prof.mean_, prof.mean(), 1e-12);
+      EXPECT_NEAR(list_prof.min_, prof.min(), 1e-12);
+      EXPECT_NEAR(list_prof.max_, prof.max(), 1e-12);
+      EXPECT_NEAR(list_prof.stddev_, prof.stddev(), 1e-9);
+
+      // One outlier in the last thousand measurements
+      EXPECT_NEAR(0.005, prof.percentile(1.0), 0.005 / rtt_rosclock::WallProf::HISTOGRAM_SUB_BUCKETS);
+      EXPECT_NEAR(150e-6, prof.percentile(0.5), 150e-6 / rtt_rosclock::WallProf::HISTOGRAM_SUB_BUCKETS);
+    }
+  }
+
+  // The capacity bounds the number of measurements
+  rtt_rosclock::WallProf small_prof(1.0, 100);
+  for(size_t i=0; i < tictocs.size(); i++) {
+    small_prof.add(tictocs[i].first, tictocs[i].second);
+  }
+  EXPECT_EQ(100U, small_prof.n());
+}
+
+TEST_F(ProfBenchmark, SamplesPerSecond)
+{
+  RTT::os::TimeService *time_service = RTT::os::TimeService::Instance();
+  const size_t n_rounds = 20;
+
+  rtt_rosclock::WallProf prof(1.0, 2000);
+  RTT::nsecs start = time_service->getNSecs();
+  for(size_t round=0; round < n_rounds; round++) {
+    for(size_t i=0; i < tictocs.size(); i++) {
+      prof.add(tictocs[i].first, tictocs[i].second);
+      prof.analyze();
+    }
+  }
+  const RTT::Seconds ring = RTT::nsecs_to_Seconds(time_service->getNSecs() - start);
+
+  ListWallProf list_prof(1.0);
+  start = time_service->getNSecs();
+  for(size_t round=0; round < n_rounds; round++) {
+    for(size_t i=0; i < tictocs.size(); i++) {
+      list_prof.add(tictocs[i].first, tictocs[i].second);
+      list_prof.analyze();
+    }
+  }
+  const RTT::Seconds list = RTT::nsecs_to_Seconds(time_service->getNSecs() - start);
+
+  const size_t n_samples = n_rounds * tictocs.size();
+  std::cerr << "[ BENCHMARK] toc and analyze of a 1000 sample window: "
+    << "ring buffer " << n_samples / ring << " samples/s, "
+    << "list " << n_samples / list << " samples/s" << std::endl;
+}
+
+//! Execute a profiled section \a n times
+void executeSection(rtt_rosclock::ProfileSection *section, size_t n)
+{
+  for(size_t i=0; i < n; i++) {
+    rtt_rosclock::ProfileSection::Scope scope(*section);
+  }
+}
+
+//! Record \a n timings of a section without timing it, which does not register the calling thread
+void recordSection(unsigned int section, size_t n)
+{
+  const ros::Time now = rtt_rosclock::rtt_wall_now();
+  for(size_t i=0; i < n; i++) {
+    rtt_rosclock::Profiler::Record(section, now, now);
+  }
+}
+
+TEST(ProfilerBenchmark, RecordsPerSecond)
+{
+  RTT::os::TimeService *time_service = RTT::os::TimeService::Instance();
+  const size_t n_threads = 4;
+  const size_t n_records = 1000;
+
+  // Don't publish the statistics
+  ASSERT_TRUE(rtt_rosclock::set_profiler_topic(""));
+
+  rtt_rosclock::ProfileSection section("benchmark");
+  ASSERT_TRUE(rtt_rosclock::enable_profiler());
+
+  // Record fewer timings per period than fit into the buffer of each thread.
+  // Each thread is registered by its first timing.
+  RTT::nsecs start = time_service->getNSecs();
+  boost::thread_group threads;
+  for(size_t i=0; i < n_threads; i++) {
+    threads.create_thread(boost::bind(&executeSection, &section, n_records));
+  }
+  threads.join_all();
+  const RTT::Seconds elapsed = RTT::nsecs_to_Seconds(time_service->getNSecs() - start);
+
+  // Stopping the profiler drains the remaining timings
+  ASSERT_TRUE(rtt_rosclock::disable_profiler());
+
+  const std::vector<std::string> sections = rtt_rosclock::get_profile_sections();
+  ASSERT_EQ(1U, sections.size());
+  EXPECT_EQ("benchmark", sections[0]);
+  EXPECT_EQ(0U, rtt_rosclock::get_profiler_dropped_timings());
+
+  const double mean = rtt_rosclock::get_profile_mean("benchmark");
+  EXPECT_GT(mean, 0.0);
+  EXPECT_LE(rtt_rosclock::get_profile_percentile("benchmark", 0.5), rtt_rosclock::get_profile_percentile("benchmark", 0.99));
+
+  // Timings are not recorded while the profiler is stopped
+  executeSection(&section, n_records);
+  EXPECT_EQ(mean, rtt_rosclock::get_profile_mean("benchmark"));
+
+  // Timings of threads which have not been registered are dropped
+  ASSERT_TRUE(rtt_rosclock::enable_profiler());
+  boost::thread unregistered(boost::bind(&recordSection, rtt_rosclock::add_profile_section("benchmark"), n_records));
+  unregistered.join();
+  ASSERT_TRUE(rtt_rosclock::disable_profiler());
+  EXPECT_EQ(n_records, rtt_rosclock::get_profiler_dropped_timings());
+  EXPECT_EQ(mean, rtt_rosclock::get_profile_mean("benchmark"));
+
+  std::cerr << "[ BENCHMARK] profiled section from " << n_threads << " threads: "
+    << n_threads * n_records / elapsed << " records/s, "
+    << "mean duration " << mean * 1E9 << " ns" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  // Initialize Orocos
+  __os_init(argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,275 @@
+/** Copyright (c) 2013, Jonathan Bohren, all rights reserved.
+ * This software is released under the BSD 3-clause license, for the details of
+ * this license, please see LICENSE.txt at the root of this repository.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/InputPort.hpp>
+#include <rtt/OutputPort.hpp>
+#include <rtt/os/startstop.h>
+#include <rtt/os/TimeService.hpp>
+#include <rtt/os/Time.hpp>
+#include <rtt/os/Mutex.hpp>
+#include <rtt/os/MutexLock.hpp>
+
+#include <ros/ros.h>
+
+#include <rtt_rosclock/rtt_rosclock.h>
+#include <rtt_rosclock/rtt_rosclock_sim_clock_activity.h>
+#include <rtt_rosclock/rtt_rosclock_sim_clock_activity_manager.h>
+
+#include <gtest/gtest.h>
+
+//! Order in which the components have been updated, guarded by order_mutex
+static std::vector<int> order;
+static RTT::os::Mutex order_mutex;
+
+//! A controller which does a fixed amount of work in each update
+class BusyComponent : public RTT::TaskContext
+{
+public:
+  BusyComponent(const std::string &name, int id, int work) :
+    RTT::TaskContext(name),
+    id_(id),
+    work_(work),
+    result_(0.0)
+  {
+    this->setActivity(new rtt_rosclock::SimClockActivity(0.0));
+  }
+
+  virtual void updateHook() {
+    double x = id_;
+    for(int i=0; i < work_; i++) {
+      x = std::sin(x) + 1.0;
+    }
+    result_ = x;
+
+    RTT::os::MutexLock lock(order_mutex);
+    order.push_back(id_);
+  }
+
+private:
+  int id_;
+  int work_;
+  volatile double result_;
+};
+
+//! A stage of a pipeline, which adds one to the value it reads
+class StageComponent : public RTT::TaskContext
+{
+public:
+  StageComponent(const std::string &name) :
+    RTT::TaskContext(name),
+    value(0.0)
+  {
+    this->ports()->addPort("in", in);
+    this->ports()->addPort("out", out);
+    this->setActivity(new rtt_rosclock::SimClockActivity(0.0));
+  }
+
+  virtual void updateHook() {
+    double input = 0.0;
+    in.read(input);
+    value = input + 1.0;
+    out.write(value);
+  }
+
+  RTT::InputPort<double> in;
+  RTT::OutputPort<double> out;
+  double value;
+};
+
+class SimClockBenchmark : public ::testing::Test
+{
+protected:
+  virtual void SetUp() {
+    manager = rtt_rosclock::SimClockActivityManager::Instance();
+    order.clear();
+  }
+
+  virtual void TearDown() {
+    for(size_t i=0; i < components.size(); i++) {
+      components[i]->stop();
+    }
+    components.clear();
+    manager->setThreads(1);
+  }
+
+  void createComponents(size_t n, int work) {
+    for(size_t i=components.size(); i < n; i++) {
+      components.push_back(boost::shared_ptr<BusyComponent>(
+            new BusyComponent("busy" + boost::lexical_cast<std::string>(i), static_cast<int>(i), work)));
+      ASSERT_TRUE(components.back()->start());
+    }
+  }
+
+  //! Get the number of simulation steps per second
+  double stepsPerSecond(size_t n_steps) {
+    RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+    for(size_t step=0; step < n_steps; step++) {
+      manager->update();
+    }
+    return n_steps / RTT::os::TimeService::Instance()->secondsSince(start);
+  }
+
+  boost::shared_ptr<rtt_rosclock::SimClockActivityManager> manager;
+  std::vector<boost::shared_ptr<BusyComponent> > components;
+};
+
+TEST_F(SimClockBenchmark, ExecutesAllActivities)
+{
+  createComponents(10, 10);
+  manager->setThreads(4);
+  EXPECT_EQ(4U, manager->getThreads());
+
+  manager->update();
+  EXPECT_EQ(10U, order.size());
+}
+
+TEST_F(SimClockBenchmark, OrderingGroups)
+{
+  createComponents(10, 1000);
+  manager->setThreads(4);
+
+  // Components 1, 4 and 7 must run in this order
+  EXPECT_TRUE(rtt_rosclock::set_sim_clock_group(components[1].get(), "ordered"));
+  EXPECT_TRUE(rtt_rosclock::set_sim_clock_group(components[4].get(), "ordered"));
+  EXPECT_TRUE(rtt_rosclock::set_sim_clock_group(components[7].get(), "ordered"));
+
+  for(size_t step=0; step < 100; step++) {
+    order.clear();
+    manager->update();
+    ASSERT_EQ(10U, order.size());
+
+    std::vector<int> ordered;
+    for(size_t i=0; i < order.size(); i++) {
+      if(order[i] == 1 || order[i] == 4 || order[i] == 7) {
+        ordered.push_back(order[i]);
+      }
+    }
+    ASSERT_EQ(3U, ordered.size());
+    EXPECT_EQ(1, ordered[0]);
+    EXPECT_EQ(4, ordered[1]);
+    EXPECT_EQ(7, ordered[2]);
+  }
+}
+
+TEST_F(SimClockBenchmark, DataFlowDependencies)
+{
+  // Create the stages of the pipeline first -> second -> third in reverse order
+  StageComponent third("third"), second("second"), first("first");
+  ASSERT_TRUE(first.out.connectTo(&second.in));
+  ASSERT_TRUE(second.out.connectTo(&third.in));
+  ASSERT_TRUE(first.start());
+  ASSERT_TRUE(second.start());
+  ASSERT_TRUE(third.start());
+
+  rtt_rosclock::derive_sim_clock_dependencies();
+  manager->setThreads(4);
+
+  // The value propagates through the whole pipeline in one step
+  manager->update();
+  EXPECT_EQ(1.0, first.value);
+  EXPECT_EQ(2.0, second.value);
+  EXPECT_EQ(3.0, third.value);
+
+  first.stop();
+  second.stop();
+  third.stop();
+}
+
+TEST_F(SimClockBenchmark, StepsPerSecond)
+{
+  const size_t n_steps = 200;
+  const unsigned int n_threads = 4;
+  const size_t counts[] = {1, 10, 40};
+
+  for(size_t i=0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    createComponents(counts[i], 10000);
+
+    manager->setThreads(1);
+    const double sequential = stepsPerSecond(n_steps);
+
+    manager->setThreads(n_threads);
+    const double parallel = stepsPerSecond(n_steps);
+
+    std::cerr << "[ BENCHMARK] " << counts[i] << " activities: "
+      << "sequential " << sequential << " steps/s, "
+      << n_threads << " threads " << parallel << " steps/s" << std::endl;
+  }
+}
+
+TEST_F(SimClockBenchmark, ScalesWithDueActivities)
+{
+  const size_t n_steps = 900;
+  const size_t counts[] = {100, 1000, 5000};
+  // Simulated time advances by one millisecond per step
+  const int64_t dt_nsec = 1000000;
+
+  // Update the clock like a simulator would, which also sets the simulation period
+  rtt_rosclock::use_manual_clock();
+  ASSERT_TRUE(rtt_rosclock::enable_sim());
+  RTT::os::TimeService *time_service = RTT::os::TimeService::Instance();
+  // Start late enough for all activities to be due in the first step
+  int64_t now_nsec = 10 * 1000000000LL;
+
+  for(size_t i=0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    // One in a hundred activities follows the simulation period, the others run at 1Hz
+    std::vector<boost::shared_ptr<rtt_rosclock::SimClockActivity> > activities;
+    for(size_t j=0; j < counts[i]; j++) {
+      activities.push_back(boost::shared_ptr<rtt_rosclock::SimClockActivity>(
+            new rtt_rosclock::SimClockActivity(j % 100 == 0 ? 0.0 : 1.0)));
+      ASSERT_TRUE(activities.back()->start());
+    }
+
+    // The first step executes all activities
+    now_nsec += dt_nsec;
+    rtt_rosclock::update_sim_clock(ros::Time().fromNSec(now_nsec));
+
+    // The simulated time is stopped, so the steps are timed with the wall clock
+    const RTT::nsecs start = time_service->getNSecs();
+    for(size_t step=0; step < n_steps; step++) {
+      now_nsec += dt_nsec;
+      rtt_rosclock::update_sim_clock(ros::Time().fromNSec(now_nsec));
+    }
+    const RTT::Seconds elapsed = RTT::nsecs_to_Seconds(time_service->getNSecs() - start);
+
+    // Only the fast activities have been executed in the last step
+    size_t executed = 0;
+    for(size_t j=0; j < activities.size(); j++) {
+      if(activities[j]->getLastExecutionTicks() == time_service->getTicks()) {
+        executed++;
+      }
+    }
+    EXPECT_EQ((counts[i] + 99) / 100, executed);
+
+    std::cerr << "[ BENCHMARK] " << counts[i] << " activities: "
+      << n_steps / elapsed << " steps/s" << std::endl;
+
+    for(size_t j=0; j < activities.size(); j++) {
+      activities[j]->stop();
+    }
+  }
+
+  ASSERT_TRUE(rtt_rosclock::disable_sim());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  // Initialize Orocos
+  __os_init(argc, argv);
+
+  // The clock thread has a NodeHandle, but the benchmark does not need a master
+  ros::init(argc, argv, "rtt_rosclock_sim_clock_benchmark", ros::init_options::AnonymousName | ros::init_options::NoSigintHandler);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,189 @@
+/** Copyright (c) 2013, Jonathan Bohren, all rights reserved.
+ * This software is released under the BSD 3-clause license, for the details of
+ * this license, please see LICENSE.txt at the root of this repository.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+
+#include <rtt/TaskContext.hpp>
+#include <rtt/os/startstop.h>
+
+#include <ros/ros.h>
+
+#include <rtt_rosclock/rtt_rosclock.h>
+#include <rtt_rosclock/rtt_rosclock_sim_clock_activity.h>
+#include <rtt_rosclock/rtt_rosclock_sim_clock_shm.h>
+
+#include <gtest/gtest.h>
+
+//! A component whose updates can be held up, so that clock ticks are written in the meantime
+class GatedComponent : public RTT::TaskContext
+{
+public:
+  GatedComponent(const std::string &name) :
+    RTT::TaskContext(name),
+    updates(0),
+    held_(false)
+  {
+    this->setActivity(new rtt_rosclock::SimClockActivity(0.0));
+  }
+
+  virtual void updateHook() {
+    boost::mutex::scoped_lock lock(mutex_);
+    processed = rtt_rosclock::rtt_now();
+    updates++;
+    condition_.notify_all();
+    while(held_) {
+      condition_.wait(lock);
+    }
+  }
+
+  void hold() {
+    boost::mutex::scoped_lock lock(mutex_);
+    held_ = true;
+  }
+
+  void release() {
+    boost::mutex::scoped_lock lock(mutex_);
+    held_ = false;
+    condition_.notify_all();
+  }
+
+  //! Wait until the component has been updated \a n times
+  bool waitForUpdates(size_t n) {
+    boost::mutex::scoped_lock lock(mutex_);
+    const boost::system_time timeout = boost::get_system_time() + boost::posix_time::seconds(5);
+    while(updates < n) {
+      if(!condition_.timed_wait(lock, timeout)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  ros::Time processed;
+  size_t updates;
+
+private:
+  boost::mutex mutex_;
+  boost::condition_variable condition_;
+  bool held_;
+};
+
+class SimClockShmTest : public ::testing::Test
+{
+protected:
+  virtual void SetUp() {
+    name = "/rtt_rosclock_tests_" + boost::lexical_cast<std::string>(::getpid());
+  }
+
+  std::string name;
+};
+
+TEST_F(SimClockShmTest, WriteRead)
+{
+  rtt_rosclock::SimClockShm writer, reader;
+  EXPECT_FALSE(reader.open(name));
+  EXPECT_FALSE(reader.isOpen());
+
+  ASSERT_TRUE(writer.create(name));
+  ASSERT_TRUE(reader.open(name));
+  EXPECT_TRUE(reader.isOpen());
+
+  // Nothing has been written yet
+  ros::Time time;
+  uint64_t ticks = 0;
+  EXPECT_FALSE(reader.read(time, ticks));
+
+  writer.write(ros::Time(1, 500));
+  ASSERT_TRUE(reader.read(time, ticks));
+  EXPECT_EQ(ros::Time(1, 500), time);
+  EXPECT_EQ(1U, ticks);
+
+  // Only the latest tick can be read
+  writer.write(ros::Time(2, 0));
+  writer.write(ros::Time(3, 0));
+  ASSERT_TRUE(reader.read(time, ticks));
+  EXPECT_EQ(ros::Time(3, 0), time);
+  EXPECT_EQ(3U, ticks);
+
+  EXPECT_EQ(0U, writer.acknowledged());
+  reader.acknowledge(ticks);
+  EXPECT_EQ(3U, writer.acknowledged());
+
+  // The creator removes the segment
+  reader.close();
+  writer.close();
+  EXPECT_FALSE(reader.open(name));
+}
+
+TEST_F(SimClockShmTest, RejectsSmallSegments)
+{
+  // A segment which has not been resized to the clock yet
+  int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT, 0666);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(0, ::ftruncate(fd, 4));
+  ::close(fd);
+
+  rtt_rosclock::SimClockShm reader;
+  EXPECT_FALSE(reader.open(name));
+  EXPECT_FALSE(reader.isOpen());
+
+  ::shm_unlink(name.c_str());
+}
+
+TEST_F(SimClockShmTest, CountsDroppedTicks)
+{
+  rtt_rosclock::SimClockShm writer;
+  ASSERT_TRUE(writer.create(name));
+
+  GatedComponent component("gated_component");
+  ASSERT_TRUE(component.start());
+
+  ASSERT_TRUE(rtt_rosclock::use_shared_memory_clock(name));
+  ASSERT_TRUE(rtt_rosclock::enable_sim());
+
+  // Hold up the update of the first tick
+  component.hold();
+  writer.write(ros::Time(10, 0));
+  ASSERT_TRUE(component.waitForUpdates(1));
+
+  // The first two of these ticks are overwritten before they are read
+  writer.write(ros::Time(11, 0));
+  writer.write(ros::Time(12, 0));
+  writer.write(ros::Time(13, 0));
+  component.release();
+
+  // The simulator sees when the last tick has been processed
+  const ros::WallTime timeout = ros::WallTime::now() + ros::WallDuration(5.0);
+  while(writer.acknowledged() != 4 && ros::WallTime::now() < timeout) {
+    ros::WallDuration(0.001).sleep();
+  }
+  ASSERT_EQ(4U, writer.acknowledged());
+
+  EXPECT_EQ(2U, rtt_rosclock::get_sim_clock_received_ticks());
+  EXPECT_EQ(2U, rtt_rosclock::get_sim_clock_dropped_ticks());
+
+  EXPECT_TRUE(rtt_rosclock::disable_sim());
+  component.stop();
+  EXPECT_EQ(ros::Time(13, 0), component.processed);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  // Initialize Orocos
+  __os_init(argc, argv);
+
+  // The clock thread has a NodeHandle, but the test does not need a master
+  ros::init(argc, argv, "rtt_rosclock_sim_clock_shm_test", ros::init_options::AnonymousName | ros::init_options::NoSigintHandler);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,164 @@
+/** Copyright (c) 2013, Jonathan Bohren, all rights reserved.
+ * This software is released under the BSD 3-clause license, for the details of
+ * this license, please see LICENSE.txt at the root of this repository.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include <rtt/os/startstop.h>
+#include <rtt/os/TimeService.hpp>
+#include <rtt/os/Time.hpp>
+
+#include <ros/ros.h>
+
+#include <rtt_rosclock/rtt_rosclock.h>
+#include <rtt_rosclock/rtt_rosclock_sim_clock_thread.h>
+#include <rtt_rosclock/rtt_rosclock_high_resolution_clock.h>
+#include <rtt_rosclock/rtt_rosclock_offset_estimator.h>
+
+#include <gtest/gtest.h>
+
+//! Number of time stamps taken in each benchmark
+static const size_t N_CALLS = 10000000;
+
+//! Get the number of calls of \a now per second
+template<class Now>
+double callsPerSecond(Now now)
+{
+  RTT::os::TimeService *time_service = RTT::os::TimeService::Instance();
+  uint32_t sum = 0;
+
+  const RTT::nsecs start = time_service->getNSecs();
+  for(size_t i=0; i < N_CALLS; i++) {
+    sum += now().nsec;
+  }
+  const RTT::Seconds elapsed = RTT::nsecs_to_Seconds(time_service->getNSecs() - start);
+
+  // Use the time stamps, so the calls are not optimized away
+  volatile uint32_t result = sum;
+  (void)result;
+
+  return N_CALLS / elapsed;
+}
+
+//! The time stamp as host_now() took it before, with a copy of the singleton
+const ros::Time singletonHostNow()
+{
+  boost::shared_ptr<rtt_rosclock::SimClockThread> instance = rtt_rosclock::SimClockThread::GetInstance();
+  if(instance && instance->simTimeEnabled()) {
+    return rtt_rosclock::rtt_now();
+  }
+  return ros::Time::now();
+}
+
+TEST(TimeBenchmark, SimTimeEnabled)
+{
+  rtt_rosclock::use_manual_clock();
+  ASSERT_TRUE(rtt_rosclock::enable_sim());
+  EXPECT_TRUE(rtt_rosclock::SimClockThread::SimTimeEnabled());
+
+  rtt_rosclock::update_sim_clock(ros::Time(10, 0));
+  EXPECT_EQ(ros::Time(10, 0), rtt_rosclock::host_now());
+  EXPECT_EQ(rtt_rosclock::rtt_now(), rtt_rosclock::host_now());
+
+  ASSERT_TRUE(rtt_rosclock::disable_sim());
+  EXPECT_FALSE(rtt_rosclock::SimClockThread::SimTimeEnabled());
+  EXPECT_LT(ros::Time(1000, 0), rtt_rosclock::host_now());
+}
+
+TEST(TimeBenchmark, CallsPerSecond)
+{
+  // Create the singleton, as loading the ros.clock service does
+  rtt_rosclock::SimClockThread::Instance();
+
+  std::cerr << "[ BENCHMARK] host_now " << callsPerSecond(rtt_rosclock::host_now) << " calls/s, "
+    << "with a copy of the singleton " << callsPerSecond(singletonHostNow) << " calls/s, "
+    << "rtt_now " << callsPerSecond(rtt_rosclock::rtt_now) << " calls/s" << std::endl;
+
+  ASSERT_TRUE(rtt_rosclock::enable_sim());
+  std::cerr << "[ BENCHMARK] simulated host_now " << callsPerSecond(rtt_rosclock::host_now) << " calls/s, "
+    << "with a copy of the singleton " << callsPerSecond(singletonHostNow) << " calls/s" << std::endl;
+  ASSERT_TRUE(rtt_rosclock::disable_sim());
+}
+
+TEST(TimeBenchmark, HighResolutionClock)
+{
+  ASSERT_TRUE(rtt_rosclock::use_high_resolution_host_clock());
+
+  // The clock is monotonic and close to the system clock
+  ros::Time last = rtt_rosclock::host_wall_now();
+  for(size_t i=0; i < N_CALLS; i++) {
+    const ros::Time now = rtt_rosclock::host_wall_now();
+    ASSERT_LE(last, now);
+    last = now;
+  }
+  EXPECT_NEAR(ros::WallTime::now().toSec(), rtt_rosclock::host_wall_now().toSec(), 1e-3);
+  EXPECT_NEAR(0.0, rtt_rosclock::HighResolutionClock::Instance().getError(), 1e-3);
+
+  std::cerr << "[ BENCHMARK] host_wall_now with the "
+    << (rtt_rosclock::HighResolutionClock::Instance().getCounter() == rtt_rosclock::HighResolutionClock::COUNTER_TSC ? "TSC " : "CLOCK_MONOTONIC_RAW ")
+    << callsPerSecond(rtt_rosclock::host_wall_now) << " calls/s, ";
+
+  rtt_rosclock::use_ros_host_clock();
+  std::cerr << "with ROS " << callsPerSecond(rtt_rosclock::host_wall_now) << " calls/s" << std::endl;
+}
+
+//! Convert a fixed RTT time stamp to the host clock
+const ros::Time hostFromRTT()
+{
+  return rtt_rosclock::host_from_rtt(ros::Time(1000, 0));
+}
+
+TEST(TimeBenchmark, OffsetEstimator)
+{
+  ASSERT_TRUE(rtt_rosclock::enable_host_offset_estimator());
+
+  // Wait for the filter to settle
+  for(size_t i=0; i < 20; i++) {
+    usleep(rtt_rosclock::OffsetEstimator::PERIOD * 1e6);
+  }
+  ASSERT_TRUE(rtt_rosclock::OffsetEstimator::HasEstimate());
+
+  // Compare the spread of the estimates with the spread of the instantaneous offsets
+  const size_t n_samples = 20;
+  double instant_sum = 0.0, instant_sq_sum = 0.0, estimate_sum = 0.0, estimate_sq_sum = 0.0;
+  for(size_t i=0; i < n_samples; i++) {
+    const double instant = rtt_rosclock::host_offset_from_rtt();
+    const double estimate = rtt_rosclock::host_offset_estimate();
+    instant_sum += instant;
+    instant_sq_sum += instant * instant;
+    estimate_sum += estimate;
+    estimate_sq_sum += estimate * estimate;
+    EXPECT_NEAR(instant, estimate, 1e-3);
+    usleep(rtt_rosclock::OffsetEstimator::PERIOD * 1e6);
+  }
+
+  const ros::Time rtt = rtt_rosclock::rtt_wall_now();
+  const ros::Time host = rtt_rosclock::host_wall_now();
+  EXPECT_NEAR(host.toSec(), rtt_rosclock::host_from_rtt(rtt).toSec(), 1e-3);
+
+  std::cerr << "[ BENCHMARK] offset standard deviation: instantaneous "
+    << std::sqrt(std::max(0.0, instant_sq_sum / n_samples - std::pow(instant_sum / n_samples, 2))) << " s, "
+    << "estimated " << std::sqrt(std::max(0.0, estimate_sq_sum / n_samples - std::pow(estimate_sum / n_samples, 2))) << " s, "
+    << "host_from_rtt " << callsPerSecond(hostFromRTT) << " calls/s" << std::endl;
+
+  ASSERT_TRUE(rtt_rosclock::disable_host_offset_estimator());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  // Initialize Orocos
+  __os_init(argc, argv);
+
+  // The clock thread has a NodeHandle, but the benchmark does not need a master
+  ros::init(argc, argv, "rtt_rosclock_time_benchmark", ros::init_options::AnonymousName | ros::init_options::NoSigintHandler);
+  ros::Time::init();
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+/** Copyright (c) 2013, Jonathan Bohren, all rights reserved.
+ * This software is released under the BSD 3-clause license, for the details of
+ * this license, please see LICENSE.txt at the root of this repository.
+ */
+
+#include <string>
+
+#include <rtt/os/startstop.h>
+
+#include <rtt/RTT.hpp>
+#include <rtt/Activity.hpp>
+#include <rtt/Logger.hpp>
+#include <rtt/deployment/ComponentLoader.hpp>
+#include <rtt/plugin/PluginLoader.hpp>
+#include <rtt/internal/GlobalService.hpp>
+
+#include <ros/ros.h>
+#include <std_srvs/Empty.h>
+
+#include <gtest/gtest.h>
+
+class EmptyServiceComponent : public RTT::TaskContext
+{
+public:
+  EmptyServiceComponent(const std::string &name) :
+    RTT::TaskContext(name),
+    empty_caller("empty_caller")
+  {
+    this->provides("bench")->addOperation("empty", &EmptyServiceComponent::empty, this, RTT::OwnThread);
+    this->requires("bench")->addOperationCaller(empty_caller);
+  }
+
+  bool empty(std_srvs::Empty::Request &request, std_srvs::Empty::Response &response) { return true; }
+
+  RTT::OperationCaller<bool(std_srvs::Empty::Request&, std_srvs::Empty::Response&)> empty_caller;
+};
+
+TEST(ServiceProxyBenchmark, EmptyCallsPerSecond)
+{
+  RTT::Service::shared_ptr ros = RTT::internal::GlobalService::Instance()->provides("ros");
+  RTT::OperationCaller<bool(const std::string&)> ros_import = ros->getOperation("import");
+  ASSERT_TRUE(ros_import.ready());
+  ASSERT_TRUE(ros_import("rtt_roscomm"));
+  ASSERT_TRUE(ros_import("rtt_std_srvs"));
+
+  if(!ros::isStarted()) {
+    std::cerr << "[ SKIPPED  ] No ROS master running." << std::endl;
+    return;
+  }
+
+  EmptyServiceComponent tc("empty_service_component");
+  tc.setActivity(new RTT::Activity());
+  ASSERT_TRUE(RTT::plugin::PluginLoader::Instance()->loadService("rosservice", &tc));
+
+  RTT::OperationCaller<bool(const std::string&, const std::string&, const std::string&)> connect =
+    tc.provides("rosservice")->getOperation("connect");
+  ASSERT_TRUE(connect("bench.empty", "/rtt_roscomm_tests/empty", "std_srvs/Empty"));
+  ASSERT_TRUE(connect("bench.empty_caller", "/rtt_roscomm_tests/empty", "std_srvs/Empty"));
+  ASSERT_TRUE(tc.start());
+
+  std_srvs::Empty::Request request;
+  std_srvs::Empty::Response response;
+
+  // Warm up the connection
+  ASSERT_TRUE(ros::service::waitForService("/rtt_roscomm_tests/empty", 5000));
+  ASSERT_TRUE(tc.empty_caller(request, response));
+
+  const size_t n_calls = 2000;
+  ros::WallTime start = ros::WallTime::now();
+  for(size_t i=0; i < n_calls; i++) {
+    ASSERT_TRUE(tc.empty_caller(request, response));
+  }
+  const double elapsed = (ros::WallTime::now() - start).toSec();
+
+  std::cerr << "[ BENCHMARK] " << n_calls << " std_srvs/Empty calls through client and server proxies in "
+    << elapsed << " s (" << n_calls / elapsed << " calls/s)" << std::endl;
+
+  tc.stop();
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  // Initialize Orocos
+  __os_init(argc, argv);
+
+  RTT::Logger::log().setStdStream(std::cerr);
+  RTT::Logger::log().mayLogStdOut(true);
+  RTT::Logger::log().setLogLevel(RTT::Logger::Warning);
+
+  if(!RTT::ComponentLoader::Instance()->import("rtt_ros", "")) {
+    return 1;
+  }
+
+  return RUN_ALL_TESTS();
+}
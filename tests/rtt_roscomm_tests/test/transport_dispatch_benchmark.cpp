@@ -0,0 +1,130 @@
+/** Copyright (c) 2013, Jonathan Bohren, all rights reserved.
+ * This software is released under the BSD 3-clause license, for the details of
+ * this license, please see LICENSE.txt at the root of this repository.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <rtt/os/startstop.h>
+#include <rtt/os/TimeService.hpp>
+
+#include <rtt_roscomm/rtt_rostransport_registry.hpp>
+
+#include <gtest/gtest.h>
+
+//! Number of message types of the synthetic package
+static const size_t N_TYPES = 500;
+
+//! Stand-in for the transporter and marshaller factories of the synthetic package
+RTT::types::TypeTransporter *createNothing() { return NULL; }
+
+class TransportDispatchBenchmark : public ::testing::Test
+{
+protected:
+  virtual void SetUp() {
+    // Type names of a synthetic package with N_TYPES messages, sorted like generated tables
+    for(size_t i=0; i < N_TYPES; i++) {
+      char name[64];
+      std::snprintf(name, sizeof(name), "/bench_msgs/Message%03u", static_cast<unsigned int>(i));
+      names.push_back(name);
+    }
+    for(size_t i=0; i < N_TYPES; i++) {
+      rtt_roscomm::TransportFactory factory = { names[i].c_str(), &createNothing, &createNothing };
+      factories.push_back(factory);
+    }
+  }
+
+  //! Find a factory like the if(name == "/pkg/Msg") chains which used to be generated
+  const rtt_roscomm::TransportFactory *findLinear(const std::string &name) const {
+    for(std::vector<rtt_roscomm::TransportFactory>::const_iterator it = factories.begin(); it != factories.end(); ++it) {
+      if(name == it->name) {
+        return &*it;
+      }
+    }
+    return NULL;
+  }
+
+  //! Add the transport to a type like the generated if-chains did
+  bool registerLinear(const std::string &name, RTT::types::TypeInfo *ti) const {
+    const rtt_roscomm::TransportFactory *factory = findLinear(name);
+    if(factory == NULL) {
+      return false;
+    }
+    ti->addProtocol(ORO_ROS_SERIALIZATION_PROTOCOL_ID, factory->create_marshaller());
+    return ti->addProtocol(ORO_ROS_PROTOCOL_ID, factory->create());
+  }
+
+  //! Find a factory in the sorted table
+  const rtt_roscomm::TransportFactory *findSorted(const std::string &name) const {
+    return rtt_roscomm::findFactory(&factories.front(), &factories.front() + factories.size(), name);
+  }
+
+  //! Add the transport to a type like the registerTransport() of a generated transport plugin
+  bool registerSorted(const std::string &name, RTT::types::TypeInfo *ti) const {
+    return rtt_roscomm::registerTransportFromFactories(&factories.front(), &factories.front() + factories.size(), name, ti);
+  }
+
+  std::vector<std::string> names;
+  std::vector<rtt_roscomm::TransportFactory> factories;
+};
+
+TEST_F(TransportDispatchBenchmark, FindsAllTypes)
+{
+  for(size_t i=0; i < N_TYPES; i++) {
+    ASSERT_EQ(&factories[i], findSorted(names[i]));
+    ASSERT_EQ(&factories[i], findLinear(names[i]));
+  }
+
+  EXPECT_TRUE(findSorted("/bench_msgs/Message") == NULL);
+  EXPECT_TRUE(findSorted("/bench_msgs/Message500") == NULL);
+  EXPECT_TRUE(findSorted("/other_msgs/Message000") == NULL);
+  EXPECT_TRUE(findSorted("") == NULL);
+}
+
+TEST_F(TransportDispatchBenchmark, RegisterAllTypes)
+{
+  // RTT asks every transport plugin about every type, most of which belong to other packages
+  std::vector<std::string> queries(names);
+  for(size_t i=0; i < N_TYPES; i++) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/other_msgs/Message%03u", static_cast<unsigned int>(i));
+    queries.push_back(name);
+  }
+
+  const size_t n_rounds = 20;
+  size_t found = 0;
+  RTT::types::TypeInfo ti("bench");
+
+  RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+  for(size_t round=0; round < n_rounds; round++) {
+    for(std::vector<std::string>::const_iterator it = queries.begin(); it != queries.end(); ++it) {
+      found += registerLinear(*it, &ti);
+    }
+  }
+  const RTT::Seconds linear = RTT::os::TimeService::Instance()->secondsSince(start);
+
+  start = RTT::os::TimeService::Instance()->getTicks();
+  for(size_t round=0; round < n_rounds; round++) {
+    for(std::vector<std::string>::const_iterator it = queries.begin(); it != queries.end(); ++it) {
+      found += registerSorted(*it, &ti);
+    }
+  }
+  const RTT::Seconds sorted = RTT::os::TimeService::Instance()->secondsSince(start);
+
+  EXPECT_EQ(2 * n_rounds * N_TYPES, found);
+
+  std::cerr << "[ BENCHMARK] " << n_rounds * queries.size() << " transport registrations in a package with " << N_TYPES << " types: "
+    << "linear " << linear << " s, sorted table " << sorted << " s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  // Initialize Orocos
+  __os_init(argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,33 @@
+/** Copyright (c) 2013, Jonathan Bohren, all rights reserved.
+ * This software is released under the BSD 3-clause license, for the details of
+ * this license, please see LICENSE.txt at the root of this repository.
+ */
+
+#include <iostream>
+
+#include <rtt/os/startstop.h>
+#include <rtt/os/TimeService.hpp>
+#include <rtt/deployment/ComponentLoader.hpp>
+
+#include <gtest/gtest.h>
+
+TEST(TypekitImportBenchmark, ImportStdMsgs)
+{
+  // Load the rtt_ros plugin first, so only the typekit is timed
+  ASSERT_TRUE(RTT::ComponentLoader::Instance()->import("rtt_ros", ""));
+
+  RTT::os::TimeService::ticks start = RTT::os::TimeService::Instance()->getTicks();
+  EXPECT_TRUE(RTT::ComponentLoader::Instance()->import("rtt_std_msgs", ""));
+  const RTT::Seconds elapsed = RTT::os::TimeService::Instance()->secondsSince(start);
+
+  std::cerr << "[ BENCHMARK] importing the rtt_std_msgs typekit took " << elapsed << " s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  // Initialize Orocos
+  __os_init(argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,41 @@
+#ifndef __RTT_KDL_CONVERSIONS_KDL_BULK_CONVERSIONS_H
+#define __RTT_KDL_CONVERSIONS_KDL_BULK_CONVERSIONS_H
+
+#include <vector>
+
+#include <kdl/frames.hpp>
+#include <kdl/jntarray.hpp>
+
+#include <geometry_msgs/Pose.h>
+#include <geometry_msgs/PoseArray.h>
+#include <geometry_msgs/Transform.h>
+#include <trajectory_msgs/JointTrajectory.h>
+
+/** \brief Conversions of arrays of ROS messages to and from KDL
+ *
+ * These give the same results as calling the per-object conversions of
+ * kdl_conversions for each element, but convert the whole array in one pass.
+ * Quaternions are converted to rotation matrices two at a time with SSE2 where
+ * it is available. The output vectors are resized to the size of the input,
+ * so they do not allocate memory when they are reused with inputs of the same
+ * size.
+ */
+namespace rtt_kdl_conversions {
+
+  //! Convert an array of Pose messages to KDL Frames
+  void posesMsgToKDL(const std::vector<geometry_msgs::Pose> &m, std::vector<KDL::Frame> &k);
+
+  //! Convert an array of KDL Frames to Pose messages
+  void posesKDLToMsg(const std::vector<KDL::Frame> &k, std::vector<geometry_msgs::Pose> &m);
+
+  //! Convert the poses of a PoseArray message to KDL Frames
+  void poseArrayMsgToKDL(const geometry_msgs::PoseArray &m, std::vector<KDL::Frame> &k);
+
+  //! Convert an array of Transform messages to KDL Frames
+  void transformsMsgToKDL(const std::vector<geometry_msgs::Transform> &m, std::vector<KDL::Frame> &k);
+
+  //! Convert the positions of the points of a JointTrajectory message to KDL JntArrays
+  void jointTrajectoryMsgToKDL(const trajectory_msgs::JointTrajectory &m, std::vector<KDL::JntArray> &k);
+}
+
+#endif // ifndef __RTT_KDL_CONVERSIONS_KDL_BULK_CONVERSIONS_H
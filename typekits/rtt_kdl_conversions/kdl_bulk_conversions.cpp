@@ -0,0 +1,124 @@
+#include <rtt_kdl_conversions/kdl_bulk_conversions.h>
+
+#include <kdl_conversions/kdl_msg.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+  const geometry_msgs::Point &translationOf(const geometry_msgs::Pose &m) { return m.position; }
+  const geometry_msgs::Quaternion &rotationOf(const geometry_msgs::Pose &m) { return m.orientation; }
+  const geometry_msgs::Vector3 &translationOf(const geometry_msgs::Transform &m) { return m.translation; }
+  const geometry_msgs::Quaternion &rotationOf(const geometry_msgs::Transform &m) { return m.rotation; }
+
+#ifdef __SSE2__
+  //! Store the lower and upper element of \a v into two rotation matrices
+  inline void store(__m128d v, KDL::Rotation &r0, KDL::Rotation &r1, int i)
+  {
+    _mm_storel_pd(&r0.data[i], v);
+    _mm_storeh_pd(&r1.data[i], v);
+  }
+#endif
+
+  /** \brief Convert \a n messages with a translation and a quaternion to KDL Frames
+   *
+   * The rotation matrices are computed like KDL::Rotation::Quaternion(),
+   * with the same order of operations, so that the results are identical.
+   */
+  template<class Msg>
+  void framesMsgToKDL(const Msg *m, KDL::Frame *k, size_t n)
+  {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128d two = _mm_set1_pd(2.0);
+
+    for(; i + 2 <= n; i += 2) {
+      const geometry_msgs::Quaternion &q0 = rotationOf(m[i]);
+      const geometry_msgs::Quaternion &q1 = rotationOf(m[i + 1]);
+
+      const __m128d x = _mm_set_pd(q1.x, q0.x);
+      const __m128d y = _mm_set_pd(q1.y, q0.y);
+      const __m128d z = _mm_set_pd(q1.z, q0.z);
+      const __m128d w = _mm_set_pd(q1.w, q0.w);
+
+      const __m128d x2 = _mm_mul_pd(x, x);
+      const __m128d y2 = _mm_mul_pd(y, y);
+      const __m128d z2 = _mm_mul_pd(z, z);
+      const __m128d w2 = _mm_mul_pd(w, w);
+
+      const __m128d tx = _mm_mul_pd(two, x);
+      const __m128d ty = _mm_mul_pd(two, y);
+      const __m128d tw = _mm_mul_pd(two, w);
+
+      KDL::Rotation &r0 = k[i].M;
+      KDL::Rotation &r1 = k[i + 1].M;
+
+      store(_mm_sub_pd(_mm_sub_pd(_mm_add_pd(w2, x2), y2), z2), r0, r1, 0);
+      store(_mm_sub_pd(_mm_mul_pd(tx, y), _mm_mul_pd(tw, z)), r0, r1, 1);
+      store(_mm_add_pd(_mm_mul_pd(tx, z), _mm_mul_pd(tw, y)), r0, r1, 2);
+      store(_mm_add_pd(_mm_mul_pd(tx, y), _mm_mul_pd(tw, z)), r0, r1, 3);
+      store(_mm_sub_pd(_mm_add_pd(_mm_sub_pd(w2, x2), y2), z2), r0, r1, 4);
+      store(_mm_sub_pd(_mm_mul_pd(ty, z), _mm_mul_pd(tw, x)), r0, r1, 5);
+      store(_mm_sub_pd(_mm_mul_pd(tx, z), _mm_mul_pd(tw, y)), r0, r1, 6);
+      store(_mm_add_pd(_mm_mul_pd(ty, z), _mm_mul_pd(tw, x)), r0, r1, 7);
+      store(_mm_add_pd(_mm_sub_pd(_mm_sub_pd(w2, x2), y2), z2), r0, r1, 8);
+
+      k[i].p = KDL::Vector(translationOf(m[i]).x, translationOf(m[i]).y, translationOf(m[i]).z);
+      k[i + 1].p = KDL::Vector(translationOf(m[i + 1]).x, translationOf(m[i + 1]).y, translationOf(m[i + 1]).z);
+    }
+#endif
+
+    for(; i < n; i++) {
+      const geometry_msgs::Quaternion &q = rotationOf(m[i]);
+      k[i].M = KDL::Rotation::Quaternion(q.x, q.y, q.z, q.w);
+      k[i].p = KDL::Vector(translationOf(m[i]).x, translationOf(m[i]).y, translationOf(m[i]).z);
+    }
+  }
+}
+
+void rtt_kdl_conversions::posesMsgToKDL(const std::vector<geometry_msgs::Pose> &m, std::vector<KDL::Frame> &k)
+{
+  k.resize(m.size());
+  if(!m.empty()) {
+    framesMsgToKDL(&m[0], &k[0], m.size());
+  }
+}
+
+void rtt_kdl_conversions::posesKDLToMsg(const std::vector<KDL::Frame> &k, std::vector<geometry_msgs::Pose> &m)
+{
+  // Extracting quaternions branches on the largest diagonal element, so this is not vectorized
+  m.resize(k.size());
+  for(size_t i = 0; i < k.size(); i++) {
+    tf::poseKDLToMsg(k[i], m[i]);
+  }
+}
+
+void rtt_kdl_conversions::poseArrayMsgToKDL(const geometry_msgs::PoseArray &m, std::vector<KDL::Frame> &k)
+{
+  posesMsgToKDL(m.poses, k);
+}
+
+void rtt_kdl_conversions::transformsMsgToKDL(const std::vector<geometry_msgs::Transform> &m, std::vector<KDL::Frame> &k)
+{
+  k.resize(m.size());
+  if(!m.empty()) {
+    framesMsgToKDL(&m[0], &k[0], m.size());
+  }
+}
+
+void rtt_kdl_conversions::jointTrajectoryMsgToKDL(const trajectory_msgs::JointTrajectory &m, std::vector<KDL::JntArray> &k)
+{
+  k.resize(m.points.size());
+  for(size_t i = 0; i < m.points.size(); i++) {
+    const std::vector<double> &positions = m.points[i].positions;
+    if(k[i].rows() != positions.size()) {
+      k[i].resize(positions.size());
+    }
+    for(size_t j = 0; j < positions.size(); j++) {
+      k[i](j) = positions[j];
+    }
+  }
+}
@@ -1,6 +1,7 @@
 #include <rtt/types/TypekitPlugin.hpp>
 #include <rtt/internal/GlobalService.hpp>
 #include <kdl_conversions/kdl_msg.h>
+#include <rtt_kdl_conversions/kdl_bulk_conversions.h>
 
 namespace KDL
 {
@@ -35,6 +36,11 @@ namespace KDL
           gs->provides("KDL")->addOperation("MsgToTwist",&tf::TwistMsgToKDL);
           gs->provides("KDL")->addOperation("FrameToMsg",&tf::PoseKDLToMsg);
           gs->provides("KDL")->addOperation("MsgToFrame",&tf::PoseMsgToKDL);
+          gs->provides("KDL")->addOperation("posesMsgToKDL",&rtt_kdl_conversions::posesMsgToKDL);
+          gs->provides("KDL")->addOperation("posesKDLToMsg",&rtt_kdl_conversions::posesKDLToMsg);
+          gs->provides("KDL")->addOperation("poseArrayMsgToKDL",&rtt_kdl_conversions::poseArrayMsgToKDL);
+          gs->provides("KDL")->addOperation("transformsMsgToKDL",&rtt_kdl_conversions::transformsMsgToKDL);
+          gs->provides("KDL")->addOperation("jointTrajectoryMsgToKDL",&rtt_kdl_conversions::jointTrajectoryMsgToKDL);
           return true;
       }
   };